@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "openapi2.hpp"
+#include "synthetic_spec.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+// Forward-declared writers, as in main.cpp.
+void beast(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void beauty(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void nghttp2(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void router(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void validators(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void deserializers(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void serializers(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+
+namespace {
+
+struct Phase {
+	std::string_view name;
+	std::vector<double> ms;
+};
+
+class Timer {
+public:
+	explicit Timer(std::vector<Phase>& phases)
+		: _phases(phases) {}
+
+	// Runs body once and records its wall time under name. Phases are reported in the order first seen.
+	template <typename F>
+	void Measure(std::string_view name, F&& body) {
+		const auto start = std::chrono::steady_clock::now();
+		body();
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		auto it = std::find_if(_phases.begin(), _phases.end(), [name](const Phase& p) { return p.name == name; });
+		if (it == _phases.end()) {
+			it = _phases.insert(_phases.end(), Phase{name, {}});
+		}
+		it->ms.push_back(elapsed.count());
+	}
+
+private:
+	std::vector<Phase>& _phases;
+};
+
+// Touches every field a backend reads, so the traversal is not optimized away.
+size_t WalkDefinitions(const openapi::OpenAPI2& file) {
+	size_t checksum = 0;
+	for (const auto& [name, def] : file.definitions()) {
+		checksum += name.size() + def.type().size();
+		for (const auto& [key, property] : def.properties()) {
+			checksum += key.size() + property.type().size() + property.reference().size();
+		}
+	}
+	return checksum;
+}
+
+size_t WalkPaths(const openapi::OpenAPI2& file) {
+	size_t checksum = 0;
+	for (const auto& [pathstr, path] : file.paths()) {
+		checksum += pathstr.size();
+		for (const auto& [verb, op] : path.operations()) {
+			checksum += verb.size() + op.operation_id().size();
+			for (const auto& param : op.parameters()) {
+				checksum += param.name().size() + param.in().size() + param.type().size();
+			}
+			for (const auto& [code, response] : op.responses()) {
+				checksum += code.size() + response.description().size();
+			}
+		}
+	}
+	return checksum;
+}
+
+// WalkPaths, with the paths split across parallelism() threads.
+size_t WalkPathsParallel(const openapi::OpenAPI2& file) {
+	const auto sums = openapi::parallel_for_each<size_t>(file.paths(), [](size_t& checksum, std::string_view pathstr, const openapi::Path& path) {
+		checksum += pathstr.size();
+		for (const auto& [verb, op] : path.operations()) {
+			checksum += verb.size() + op.operation_id().size();
+			for (const auto& param : op.parameters()) {
+				checksum += param.name().size() + param.in().size() + param.type().size();
+			}
+			for (const auto& [code, response] : op.responses()) {
+				checksum += code.size() + response.description().size();
+			}
+		}
+	});
+	return std::accumulate(sums.begin(), sums.end(), size_t(0));
+}
+
+// Looks every path and definition up by name, as resolving names given on the command line would.
+size_t FindByName(const openapi::OpenAPI2& file) {
+	size_t checksum = 0;
+	const auto paths = file.paths();
+	for (const auto& [pathstr, path] : paths) {
+		checksum += paths.find(pathstr).operations().size();
+	}
+	const auto definitions = file.definitions();
+	for (const auto& [name, def] : definitions) {
+		checksum += definitions.find(name).type().size();
+	}
+	return checksum;
+}
+
+size_t PrintDefinitions(const openapi::OpenAPI2& file) {
+	std::ostringstream out;
+	std::string indent;
+	for (const auto& [name, def] : file.definitions()) {
+		indent.clear();
+		def.Print(out, name, indent, &file.references());
+	}
+	return out.view().size();
+}
+
+double Median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+bool ParseCount(std::string_view value, size_t& count) {
+	if (std::from_chars(value.data(), value.data() + value.size(), count).ec != std::errc()) {
+		std::cerr << "Invalid count " << value << std::endl;
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+// Times each stage of a generator run on one spec: parsing, DOM traversal, compilation and every writer.
+// Without a spec argument a synthetic one is generated, so scaling can be measured without test data.
+int main(int argc, char* argv[]) {
+	SyntheticSpecOptions synthetic;
+	fs::path input, output = fs::temp_directory_path() / "openapipp_bench";
+	size_t iterations = 5;
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--paths" && has_value) {
+			if (!ParseCount(argv[++i], synthetic.paths)) {
+				return 1;
+			}
+		} else if (arg == "--definitions" && has_value) {
+			if (!ParseCount(argv[++i], synthetic.definitions)) {
+				return 1;
+			}
+		} else if (arg == "--depth" && has_value) {
+			if (!ParseCount(argv[++i], synthetic.depth)) {
+				return 1;
+			}
+		} else if ((arg == "-n" || arg == "--iterations") && has_value) {
+			if (!ParseCount(argv[++i], iterations) || iterations == 0) {
+				return 1;
+			}
+		} else if ((arg == "-j" || arg == "--jobs") && has_value) {
+			size_t jobs = 1;
+			if (!ParseCount(argv[++i], jobs)) {
+				return 1;
+			}
+			set_parallelism(jobs == 0 ? std::thread::hardware_concurrency() : static_cast<unsigned>(jobs));
+		} else if (arg == "-o" && has_value) {
+			output = argv[++i];
+		} else if (!arg.starts_with('-') && input.empty()) {
+			input = arg;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [spec.json | --paths N --definitions M --depth D] [-n iterations] [-j jobs] [-o dir]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::error_code ec;
+	fs::create_directories(output, ec);
+	if (input.empty()) {
+		input = output / ("synthetic_" + std::to_string(synthetic.paths) + '_' + std::to_string(synthetic.definitions) + '_'
+			+ std::to_string(synthetic.depth) + ".json");
+		const auto json = synthetic_spec(synthetic);
+		std::ofstream file(input, std::ios::binary);
+		if (!file.write(json.data(), json.size())) {
+			std::cerr << "Failed to write " << input.string() << std::endl;
+			return 1;
+		}
+	}
+
+	// Backends share file names, so each gets its own directory.
+	const fs::path beast_dir = output / "beast", beauty_dir = output / "beauty", nghttp2_dir = output / "nghttp2";
+	for (const auto& dir : {beast_dir, beauty_dir, nghttp2_dir}) {
+		fs::create_directories(dir, ec);
+	}
+
+	std::vector<Phase> phases;
+	Timer timer(phases);
+	size_t checksum = 0, operations = 0, definitions = 0;
+	for (size_t i = 0; i < iterations; ++i) {
+		openapi::OpenAPI2 file;
+		bool loaded = false;
+		timer.Measure("OpenAPI2::Load", [&] { loaded = file.Load(input.string()); });
+		if (!loaded) {
+			std::cerr << "Failed to load " << input.string() << std::endl;
+			return 1;
+		}
+		timer.Measure("definitions()", [&] { checksum += WalkDefinitions(file); });
+		timer.Measure("paths()", [&] { checksum += WalkPaths(file); });
+		timer.Measure("parallel_for_each", [&] { checksum += WalkPathsParallel(file); });
+		timer.Measure("MapAdaptor::find", [&] { checksum += FindByName(file); });
+		timer.Measure("Property::Print", [&] { checksum += PrintDefinitions(file); });
+
+		openapi::CompiledSpec spec;
+		timer.Measure("CompiledSpec::Compile", [&] { spec.Compile(file); });
+		operations = spec.operations.size();
+		definitions = spec.definitions.size();
+
+		timer.Measure("validators", [&] { validators(input, beast_dir, spec); });
+		timer.Measure("deserializers", [&] { deserializers(input, beast_dir, spec); });
+		timer.Measure("serializers", [&] { serializers(input, beast_dir, spec); });
+		timer.Measure("router", [&] { router(input, beast_dir, spec); });
+		timer.Measure("beast", [&] { beast(input, beast_dir, spec); });
+		timer.Measure("beauty", [&] { beauty(input, beauty_dir, spec); });
+		timer.Measure("nghttp2", [&] { nghttp2(input, nghttp2_dir, spec); });
+	}
+
+	std::cout << input.filename().string() << ": " << fs::file_size(input, ec) << " bytes, " << operations << " operations, "
+			  << definitions << " definitions, " << iterations << " iterations (checksum " << checksum << ")\n"
+			  << std::left << std::setw(24) << "phase" << std::right << std::setw(12) << "min ms" << std::setw(12) << "median ms" << '\n'
+			  << std::fixed << std::setprecision(3);
+	double total = 0;
+	for (const auto& phase : phases) {
+		const double best = *std::min_element(phase.ms.begin(), phase.ms.end());
+		total += best;
+		std::cout << std::left << std::setw(24) << phase.name << std::right << std::setw(12) << best << std::setw(12) << Median(phase.ms) << '\n';
+	}
+	std::cout << std::left << std::setw(24) << "total" << std::right << std::setw(12) << total << std::endl;
+	return 0;
+}
@@ -0,0 +1,45 @@
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "synthetic_spec.hpp"
+
+using namespace std::literals;
+
+// Writes a synthetic spec, for feeding OpenAPIpp or OpenAPIpp_bench by hand.
+int main(int argc, char* argv[]) {
+	SyntheticSpecOptions options;
+	std::string_view output;
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		size_t* count = arg == "--paths" ? &options.paths
+			: arg == "--definitions" ? &options.definitions
+			: arg == "--depth" ? &options.depth
+			: nullptr;
+		if (count != nullptr && i + 1 < argc) {
+			const std::string_view value = argv[++i];
+			if (std::from_chars(value.data(), value.data() + value.size(), *count).ec != std::errc()) {
+				std::cerr << "Invalid count " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "-o" && i + 1 < argc) {
+			output = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--paths N] [--definitions M] [--depth D] [-o file]" << std::endl;
+			return 1;
+		}
+	}
+
+	const auto spec = synthetic_spec(options);
+	if (output.empty()) {
+		std::cout << spec;
+		return 0;
+	}
+	std::ofstream file{std::string(output), std::ios::binary};
+	if (!file.write(spec.data(), spec.size())) {
+		std::cerr << "Failed to write " << output << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include "synthetic_spec.hpp"
+
+namespace {
+
+void AppendNested(std::string& out, size_t depth) {
+	out += R"({"type": "object", "properties": {"label": {"type": "string"}, "count": {"type": "integer", "format": "int32"})";
+	if (depth > 0) {
+		out += R"(, "child": )";
+		AppendNested(out, depth - 1);
+	}
+	out += "}}";
+}
+
+void AppendDefinition(std::string& out, size_t def, const SyntheticSpecOptions& options) {
+	const auto name = "Model" + std::to_string(def);
+	out += '"' + name + R"(": {"type": "object", "description": "Synthetic definition )" + std::to_string(def) + R"(", )"
+		+ R"("required": ["id", "name"], "properties": {)"
+		+ R"("id": {"type": "integer", "format": "int64"}, )"
+		+ R"("name": {"type": "string", "pattern": "^[a-z][a-z0-9_]*$"}, )"
+		+ R"("status": {"type": "string", "enum": ["active", "inactive", "deleted"]}, )"
+		+ R"("score": {"type": "number", "format": "double"}, )"
+		+ R"("tags": {"type": "array", "items": {"type": "string"}})";
+	if (def > 0) {
+		out += R"(, "parent": {"$ref": "#/definitions/Model)" + std::to_string(def - 1) + R"("})";
+	}
+	if (options.depth > 0) {
+		out += R"(, "nested": )";
+		AppendNested(out, options.depth - 1);
+	}
+	out += "}}";
+}
+
+void AppendPath(std::string& out, size_t path, const SyntheticSpecOptions& options) {
+	const auto id = std::to_string(path);
+	const auto model = options.definitions == 0 ? std::string() : "Model" + std::to_string(path % options.definitions);
+	const auto schema = model.empty() ? std::string(R"({"type": "object"})") : R"({"$ref": "#/definitions/)" + model + R"("})";
+	out += R"("/resource)" + id + R"(/{id}": {)"
+		+ R"("get": {"operationId": "getResource)" + id + R"(", "tags": ["group)" + std::to_string(path % 10) + R"("], "parameters": [)"
+		+ R"({"name": "id", "in": "path", "required": true, "type": "integer", "format": "int64"}, )"
+		+ R"({"name": "limit", "in": "query", "type": "integer"}, )"
+		+ R"({"name": "filter", "in": "query", "type": "string", "pattern": "^[a-z]+$"}], )"
+		+ R"("responses": {"200": {"description": "ok", "schema": )" + schema + R"(}, "404": {"description": "not found"}}})";
+	if (path % 2 == 0) {
+		out += R"(, "post": {"operationId": "updateResource)" + id + R"(", "parameters": [)"
+			+ R"({"name": "id", "in": "path", "required": true, "type": "integer", "format": "int64"}, )"
+			+ R"({"name": "body", "in": "body", "required": true, "schema": )" + schema + R"(}], )"
+			+ R"("responses": {"200": {"description": "ok"}}})";
+	}
+	out += '}';
+}
+
+} // namespace
+
+std::string synthetic_spec(const SyntheticSpecOptions& options) {
+	std::string out;
+	out.reserve(512 * (options.paths + options.definitions * (options.depth + 2)));
+	out += R"({"swagger": "2.0", "info": {"title": "Synthetic", "version": "1.0"}, "host": "localhost", "basePath": "/api", "paths": {)";
+	for (size_t path = 0; path < options.paths; ++path) {
+		out += path == 0 ? "\n" : ",\n";
+		AppendPath(out, path, options);
+	}
+	out += "\n}, \"definitions\": {";
+	for (size_t def = 0; def < options.definitions; ++def) {
+		out += def == 0 ? "\n" : ",\n";
+		AppendDefinition(out, def, options);
+	}
+	out += "\n}}\n";
+	return out;
+}
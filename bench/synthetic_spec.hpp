@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Shape of a generated Swagger 2.0 document. Everything is derived from these numbers, so the same options
+// always produce the same bytes and timings can be compared across builds.
+struct SyntheticSpecOptions {
+	size_t paths = 100;       // Each path has a GET with a path and query parameters; every other one also has a POST with a body.
+	size_t definitions = 50;  // Each definition references the one before it, so the $ref graph is a chain.
+	size_t depth = 2;         // Levels of inline objects nested inside every definition.
+};
+
+std::string synthetic_spec(const SyntheticSpecOptions& options);
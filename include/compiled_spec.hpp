@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "openapi2.hpp"
+
+namespace openapi {
+
+// Flat, struct-of-arrays form of an OpenAPI2 document.
+// Compiling reads every JSON object once; afterwards backends iterate plain tables instead of going
+// through the accessors, which look a key up in the object on every call.
+// Strings are interned and referred to by StringId, everything else by index into its table.
+using StringId = uint32_t;
+using SchemaId = uint32_t;
+using DefinitionId = uint32_t;
+inline constexpr uint32_t npos = UINT32_MAX;
+
+// Half-open slice [first, first + count) of another table. Iterating it yields row indices.
+struct Range {
+	uint32_t first = 0;
+	uint32_t count = 0;
+
+	class Iterator final {
+	public:
+		Iterator(uint32_t i)
+			: _i(i) {}
+		inline uint32_t operator*() const noexcept { return _i; }
+		inline Iterator& operator++() noexcept { ++_i; return *this; }
+		inline bool operator!=(const Iterator& other) const noexcept { return _i != other._i; }
+
+	private:
+		uint32_t _i;
+	};
+
+	inline Iterator begin() const noexcept { return Iterator(first); }
+	inline Iterator end() const noexcept { return Iterator(first + count); }
+	inline bool empty() const noexcept { return count == 0; }
+};
+
+class StringPool {
+public:
+	StringPool() { intern(""); } // StringId 0 is always the empty string.
+	StringPool(const StringPool&) = delete;
+	StringPool(StringPool&&) = default;
+	StringPool& operator=(StringPool&&) = default;
+
+	StringId intern(std::string_view str);
+	// Replaces the content with strings stored elsewhere, e.g. in a mapped file, which must outlive the pool.
+	// The index intern() looks strings up in is only rebuilt if intern() is called.
+	void Adopt(std::vector<std::string_view> strings);
+	inline std::string_view operator[](StringId id) const noexcept { return _strings[id]; }
+	inline size_t size() const noexcept { return _strings.size(); }
+
+private:
+	std::deque<std::string> _storage; // Stable addresses, so _strings and _ids can hold views.
+	std::vector<std::string_view> _strings;
+	std::unordered_map<std::string_view, StringId> _ids;
+};
+
+// Operations to generate code for: those tagged with any of tags, plus those whose operationId is listed.
+// An empty selection selects every operation.
+struct Selection {
+	std::vector<std::string> tags;
+	std::vector<std::string> operation_ids;
+
+	inline bool empty() const noexcept { return tags.empty() && operation_ids.empty(); }
+	bool Selects(const simdjson::dom::element& operation) const;
+	// Canonical text of the selection, for hashing into cache keys and manifests. Empty if the selection is.
+	std::string ToString() const;
+};
+
+class CompiledSpec {
+public:
+	// One row per schema node (definitions, properties, items, parameter and response schemas).
+	struct Schemas {
+		std::vector<JsonType> kind;
+		std::vector<StringId> type;
+		std::vector<StringId> format;
+		std::vector<StringId> description;
+		std::vector<StringId> pattern;
+		std::vector<StringId> reference;   // Raw $ref string.
+		std::vector<DefinitionId> target;  // Resolved $ref, or npos.
+		std::vector<SchemaId> items;       // npos unless type == array.
+		std::vector<Range> properties;     // Into properties.
+		std::vector<Range> enum_;          // Into string_lists.
+		std::vector<Range> required;       // Into string_lists.
+		inline size_t size() const noexcept { return kind.size(); }
+	};
+	struct Properties {
+		std::vector<StringId> name;
+		std::vector<SchemaId> schema;
+		inline size_t size() const noexcept { return name.size(); }
+	};
+	struct Definitions {
+		std::vector<StringId> name;
+		std::vector<StringId> type_name; // Sanitized C++ name, unique among definitions.
+		std::vector<SchemaId> schema;
+		inline size_t size() const noexcept { return name.size(); }
+	};
+	struct Parameters {
+		std::vector<StringId> name;
+		std::vector<StringId> in;
+		std::vector<StringId> description;
+		std::vector<StringId> type;
+		std::vector<StringId> format;
+		std::vector<StringId> pattern;
+		std::vector<Range> enum_;     // Into string_lists.
+		std::vector<uint8_t> required;
+		std::vector<SchemaId> schema; // npos unless in == body.
+		std::vector<SchemaId> items;  // npos unless type == array.
+		inline size_t size() const noexcept { return name.size(); }
+	};
+	struct Responses {
+		std::vector<StringId> code;
+		std::vector<StringId> description;
+		std::vector<SchemaId> schema;
+		inline size_t size() const noexcept { return code.size(); }
+	};
+	struct Operations {
+		std::vector<uint32_t> path; // Into paths.
+		std::vector<RequestMethod> method;
+		std::vector<StringId> verb; // Method as spelled in the document.
+		std::vector<StringId> operation_id;
+		std::vector<StringId> function_name; // See FunctionName.
+		std::vector<StringId> summary;
+		std::vector<StringId> description;
+		std::vector<uint8_t> deprecated;
+		std::vector<Range> parameters; // Into parameters.
+		std::vector<Range> responses;  // Into responses.
+		std::vector<Range> tags;       // Into string_lists.
+		inline size_t size() const noexcept { return path.size(); }
+	};
+	struct Paths {
+		std::vector<StringId> name;
+		std::vector<Range> operations; // Into operations.
+		inline size_t size() const noexcept { return name.size(); }
+	};
+	// Inline object and enum schemas that occur more than once in the definitions with the same shape.
+	// Each is declared once in namespace shared_types, and every occurrence becomes an alias of it.
+	struct SharedTypes {
+		std::vector<SchemaId> schema; // The first occurrence, whose descriptions are kept.
+		std::vector<StringId> name;   // Unqualified.
+		inline size_t size() const noexcept { return schema.size(); }
+	};
+
+	// Replaces any previously compiled tables. The document is not referenced afterwards.
+	// With a selection, only the selected operations are compiled, along with the paths that have any, and only
+	// the definitions their parameters and responses reach through $ref, directly or through other definitions.
+	void Compile(const OpenAPI2& file, const Selection& selection = {});
+
+	// The selectors of a selection that no compiled operation matches, as given on the command line,
+	// e.g. "--tag pets". Checked after Compile, or after LoadCache for the same selection.
+	std::vector<std::string> UnmatchedSelectors(const Selection& selection) const;
+
+	// Binary image of the compiled tables, so a later run over the same document can skip parsing and compiling it.
+	// The file starts with kCacheVersion and key, which the caller derives from the document (e.g. its fnv1a);
+	// LoadCache fails unless both match. Loading maps the file: tables are copied out of it, strings are not.
+	static constexpr uint32_t kCacheVersion = 2;
+	bool SaveCache(const std::filesystem::path& file, uint64_t key) const;
+	bool LoadCache(const std::filesystem::path& file, uint64_t key);
+
+	// Writes the C++ declaration of a definition: a struct for objects, an enum class for string enums,
+	// an alias for anything else. Inline object and enum schemas become nested types named after their
+	// property (see NestedTypeName), and every property becomes a member of the same, sanitized, name.
+	JsonType PrintSchema(std::ostream& out, SchemaId id, std::string_view name, std::string& indent) const;
+
+	// Writes namespace shared_types, which PrintSchema refers to. Must come before every definition.
+	void PrintSharedTypes(std::ostream& out) const;
+
+	// C++ type of a schema. Inline objects and enums are named nested_name.
+	std::string CppType(SchemaId id, std::string_view nested_name) const;
+
+	// True if the C++ type of a schema takes a std::pmr allocator, which only happens with pmr set.
+	// Structs do when any member does.
+	bool UsesAllocator(SchemaId id, int depth = 0) const;
+
+	// Type name of a resolved $ref.
+	std::string_view ReferenceTypeName(SchemaId id) const;
+
+	// Name of the struct generated for an inline object schema under property (or definition) name.
+	static std::string NestedTypeName(std::string_view name);
+
+	// True if this schema is a string enum, which PrintSchema declares as an enum class.
+	bool IsEnum(SchemaId id) const;
+
+	// Enumerator of each enum value, in declaration order: a valid, unique C++ identifier.
+	std::vector<std::string> EnumeratorNames(SchemaId id) const;
+
+	// Writes enum_to_string and enum_from_string for an enum class declared by PrintSchema.
+	// Both are constexpr: to_string indexes a table, from_string switches on length before comparing.
+	void PrintEnumConversions(std::ostream& out, SchemaId id, const std::string& qualified) const;
+
+	// True if values of this schema are strings restricted by a pattern. Enums are checked by their conversion.
+	bool IsConstrainedString(SchemaId id) const;
+
+	// True if a non-body string parameter is restricted by a pattern or an enum. validators writes a function
+	// named ParameterValidatorName for each, which the generated server calls before the handler.
+	bool IsConstrainedParameter(uint32_t param) const;
+	std::string ParameterValidatorName(uint32_t op, uint32_t param) const;
+
+	// Calls visit for every struct PrintSchema or PrintSharedTypes declares, with its fully qualified name,
+	// e.g. "Owner::address_". Aliases of shared types are not visited; the shared type is, once.
+	void ForEachStruct(const std::function<void(SchemaId, const std::string&)>& visit) const;
+
+	// Calls visit for every enum class declared, with its fully qualified name, e.g. "Pet::status_". As ForEachStruct.
+	void ForEachEnum(const std::function<void(SchemaId, const std::string&)>& visit) const;
+
+	// As ForEachEnum, for the enums declared with one definition, or with the shared types if def is npos.
+	void ForEachEnumOf(DefinitionId def, const std::function<void(SchemaId, const std::string&)>& visit) const;
+
+	// Underlying type of the enum class PrintSchema declares, for opaque declarations.
+	std::string_view EnumUnderlyingType(SchemaId id) const;
+
+	// The definitions a definition's declaration names through $ref, each once, in order of appearance.
+	std::vector<DefinitionId> References(DefinitionId def) const;
+
+	// True if the declaration of def aliases any shared type.
+	bool UsesSharedTypes(DefinitionId def) const;
+
+	// Every definition, each after the definitions it references, unless they reference it back. Within such a
+	// cycle, each after those it contains by value and the aliases and enums it names; the others may come later,
+	// since structs can be forward-declared. Otherwise in document order.
+	// Definitions that contain each other by value, e.g. Pet { Pet parent; }, have no C++ declaration: if cycle is
+	// given, the first such cycle found is stored there, and the order is not usable.
+	std::vector<DefinitionId> DefinitionOrder(std::vector<DefinitionId>* cycle = nullptr) const;
+
+	// Name of the generated functions for this operation: operationId, or one synthesized from path and verb,
+	// sanitized. Unique among operations: a name taken by an earlier operation gets a numeric suffix.
+	std::string FunctionName(uint32_t op) const;
+
+	// Generate std::pmr::string and std::pmr::vector, and structs with allocator-aware constructors.
+	// An option of the generator rather than part of the document, so Compile does not set it.
+	bool pmr = false;
+
+	StringPool strings;
+	std::vector<StringId> string_lists;
+	StringId host = 0;
+	StringId base_path = 0;
+	Schemas schemas;
+	Properties properties;
+	Definitions definitions;
+	Parameters parameters;
+	Responses responses;
+	Operations operations;
+	Paths paths;
+	SharedTypes shared_types;
+	std::vector<uint32_t> shared; // Per schema: index into shared_types if PrintSchema declares it as an alias, or npos.
+
+private:
+	std::unique_ptr<__detail::PaddedMapping> _cache; // Holds the strings when loaded by LoadCache.
+	void _PrintType(std::ostream& out, SchemaId id, std::string_view name, std::string& indent) const;
+	void _PrintAllocatorConstructors(std::ostream& out, SchemaId id, std::string_view name, const std::string& indent) const;
+	void _ShareInlineTypes();
+	void _UniqueNames(std::vector<StringId>& names);
+	void _PrintNestedTypes(std::ostream& out, SchemaId id, std::string_view name, std::string& indent) const;
+	static constexpr DefinitionId kAllDefinitions = npos - 1;
+	void _ForEachNamedType(const std::function<void(SchemaId, const std::string&)>& visit, DefinitionId only = kAllDefinitions) const;
+	void _ForEachDeclaredSchema(DefinitionId def, const std::function<void(SchemaId)>& visit) const;
+	std::vector<DefinitionId> _Dependencies(DefinitionId def) const;
+	SchemaId _CompileSchema(const simdjson::dom::element& json);
+	void _CompileParameter(const simdjson::dom::element& json, const ReferenceIndex& refs);
+	void _CompileResponse(std::string_view code, const simdjson::dom::element& json, const ReferenceIndex& refs);
+	void _CompileOperation(uint32_t path, std::string_view verb, const simdjson::dom::element& json, const ReferenceIndex& refs);
+	Range _CompileStringList(const simdjson::dom::element& json);
+	StringId _Intern(const simdjson::dom::element& json);
+};
+
+} // namespace openapi
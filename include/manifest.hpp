@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include <simdjson.h>
+
+// Record of what a previous generator run was made from, kept in the output directory.
+// Each top-level member of the spec is hashed from its raw JSON text, so comparing two manifests tells whether the
+// paths, the definitions or anything else changed between runs. Finer hashes would buy nothing: type names, shared
+// inline types and declaration order each depend on every definition, so any change regenerates a whole section.
+class Manifest {
+public:
+	enum class Section : char {
+		Path = 'P',       // "paths".
+		Definition = 'D', // "definitions".
+		Global = 'G',     // Any other top-level member, plus generator options.
+		File = 'F',       // Content hash of every file the run produced.
+	};
+
+	// A missing or unreadable manifest loads as empty, which compares unequal to any spec.
+	bool Load(const std::filesystem::path& file);
+	bool Save(const std::filesystem::path& file) const;
+
+	// Hashes the top-level members of a spec. Uses simdjson::ondemand, so no DOM is built.
+	bool HashDocument(simdjson::padded_string_view json);
+	// As above, for a spec that was not JSON text to begin with (e.g. YAML): members are hashed from their minified JSON.
+	bool HashDocument(const simdjson::dom::element& root);
+
+	using Entries = std::map<std::string, uint64_t, std::less<>>;
+
+	void Set(Section section, std::string_view key, uint64_t hash);
+	const Entries& entries(Section section) const { return const_cast<Manifest*>(this)->_Entries(section); }
+
+	bool empty() const noexcept;
+
+	// True if both manifests hold exactly the same keys and hashes for this section.
+	bool SameSection(const Manifest& other, Section section) const;
+
+private:
+	Entries& _Entries(Section section);
+
+	Entries _paths;
+	Entries _definitions;
+	Entries _globals;
+	Entries _files;
+};
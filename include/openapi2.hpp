@@ -1,7 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include <simdjson.h>
 
@@ -70,17 +77,50 @@ public:
 		inline const value_type operator*() const { return value_type{this->key(), T(this->value())}; }
 	};
 	using iterator_type = Iterator;
+
+	// Objects with more members than this get a hash index on their first find(); smaller ones are scanned.
+	static constexpr size_t kIndexThreshold = 32;
+
 	MapAdaptor()
 		: simdjson::dom::object(), _is_valid(false) {}
 	MapAdaptor(const simdjson::dom::object& obj)
-		: simdjson::dom::object(obj), _is_valid(true) {}
+		: simdjson::dom::object(obj)
+		, _is_valid(true)
+		, _index(simdjson::dom::object::size() > kIndexThreshold ? std::make_shared<Index>() : nullptr) {}
 	inline Iterator begin() const noexcept { return _is_valid ? Iterator(simdjson::dom::object::begin()) : Iterator(); }
 	inline Iterator end()   const noexcept { return _is_valid ? Iterator(simdjson::dom::object::end()) : begin(); }
 	inline size_t   size()  const noexcept { return _is_valid ? simdjson::dom::object::size() : 0; }
 	inline bool     empty() const noexcept { return (size() == 0); }
 
+	// The member named key, or an invalid T if there is none. With duplicate keys, the first one wins.
+	// Copies of an adaptor share its index, so keep one around for repeated lookups (OpenAPI2 does for
+	// paths() and definitions()). Building the index is thread-safe.
+	T find(std::string_view key) const {
+		if (!_is_valid) {
+			return T();
+		}
+		if (!_index) {
+			const auto& v = simdjson::dom::object::at_key(key);
+			return simdjson_noerror(v) ? T(v) : T();
+		}
+		std::call_once(_index->built, [this] {
+			_index->elements.reserve(simdjson::dom::object::size());
+			for (const auto& [name, value] : static_cast<const simdjson::dom::object&>(*this)) {
+				_index->elements.emplace(name, value);
+			}
+		});
+		const auto it = _index->elements.find(key);
+		return it != _index->elements.end() ? T(simdjson::dom::element(it->second)) : T();
+	}
+
 private:
+	struct Index {
+		std::once_flag built;
+		std::unordered_map<std::string_view, simdjson::dom::element> elements; // Keys point into the document.
+	};
+
 	bool _is_valid;
+	std::shared_ptr<Index> _index; // Null for small objects.
 };
 
 template <typename T>
@@ -126,10 +166,59 @@ protected:
 	bool _is_valid;
 };
 
+// Read-only memory mapping of a file, followed by at least simdjson::SIMDJSON_PADDING zero bytes.
+class PaddedMapping {
+public:
+	PaddedMapping() noexcept = default;
+	PaddedMapping(const PaddedMapping&) = delete;
+	PaddedMapping(PaddedMapping&& other) noexcept;
+	PaddedMapping& operator=(PaddedMapping&& other) noexcept;
+	~PaddedMapping() { Unmap(); }
+
+	// Returns false if the file cannot be mapped (or mmap is unavailable on this platform).
+	bool Map(const std::string& path);
+	void Unmap() noexcept;
+
+	inline simdjson::padded_string_view view() const noexcept {
+		return simdjson::padded_string_view(static_cast<const char*>(_base), _len, _len + simdjson::SIMDJSON_PADDING);
+	}
+	inline explicit operator bool() const noexcept { return _base != nullptr; }
+
+private:
+	void* _base = nullptr;
+	size_t _len = 0;
+	size_t _maplen = 0;
+};
+
 } // namespace __detail
 
 using StringList = __detail::ListAdaptor<std::string_view>;
 
+// Maps full JSON Pointers such as "#/definitions/Foo" to the element they refer to.
+// Built once per document, so that resolving a $ref does not have to scan the document.
+class ReferenceIndex {
+public:
+	struct Entry {
+		simdjson::dom::element element;
+		std::string type_name; // Sanitized C++ name of the referenced definition.
+	};
+
+	void Build(const simdjson::dom::element& root);
+	void clear() noexcept { _index.clear(); }
+	size_t size() const noexcept { return _index.size(); }
+
+	// Accepts either a full pointer ("#/definitions/a~1b") or a bare definition name ("a/b").
+	// Returns nullptr if the reference does not resolve.
+	const Entry* find(std::string_view reference) const;
+
+private:
+	struct Hash {
+		using is_transparent = void;
+		size_t operator()(std::string_view sv) const noexcept { return std::hash<std::string_view>{}(sv); }
+	};
+	std::unordered_map<std::string, Entry, Hash, std::equal_to<>> _index;
+};
+
 struct Property : public __detail::OpenAPIObject<Property> {
 	using __detail::OpenAPIObject<Property>::OpenAPIObject;
 	std::string_view type() const;
@@ -148,7 +237,8 @@ struct Property : public __detail::OpenAPIObject<Property> {
 
 	bool IsReference() const noexcept;
 
-	JsonType Print(std::ostream& out, std::string_view name, std::string& indent) const;
+	// If refs is given, $ref targets are resolved through it instead of being derived from the reference string.
+	JsonType Print(std::ostream& out, std::string_view name, std::string& indent, const ReferenceIndex* refs = nullptr) const;
 };
 
 class ModelSchema;
@@ -346,17 +436,101 @@ public:
 	Definitions definitions() const;
 
 	// Should return false if JSON parsing fails or if file is not an OpenAPI swagger file.
+	// Every Load replaces the current document, reusing the capacity the parser and read buffer already hold.
 	bool Load(const std::string& path);
 
-	Property GetDefinedSchemaByReference(std::string_view);
+	// Parses a caller-owned buffer in place. If it lacks simdjson::SIMDJSON_PADDING bytes of slack, it is copied first.
+	// The buffer is not referenced once Load returns.
+	bool Load(simdjson::padded_string_view json);
+
+	// Parses an unpadded buffer by copying it into the internal read buffer.
+	bool LoadBuffer(std::string_view json);
+
+	// Parses a YAML document (see ParseYaml) into the same DOM a JSON one would give. On failure, error says why.
+	bool LoadYaml(std::string_view yaml, std::string* error = nullptr);
+
+	// Like Load(path), but maps the file into memory instead of reading it.
+	// Falls back to Load(path) where mmap is unavailable.
+	bool LoadMapped(const std::string& path);
+
+	Property GetDefinedSchemaByReference(std::string_view) const;
+
+	const ReferenceIndex& references() const noexcept { return _refs; }
+
+	// Root of the loaded document, for consumers that walk the DOM directly.
+	const simdjson::dom::element& root() const noexcept { return _root; }
+
+	// Size of the parsed document in simdjson's internal representation, for profiling.
+	struct DocumentStats {
+		size_t tape_bytes = 0;            // Used by the loaded document.
+		size_t tape_capacity = 0;         // Allocated by the parser, which keeps it for the next Load.
+		size_t string_bytes = 0;
+		size_t string_capacity = 0;
+		size_t objects = 0, arrays = 0, strings = 0, numbers = 0, literals = 0; // Literals are true, false and null.
+	};
+	DocumentStats Stats() const noexcept;
 
 private:
 	simdjson::dom::parser _parser; // Lifetime of document depends on lifetime of parser, so parser must be kept alive.
 	simdjson::dom::element _root;
+	ReferenceIndex _refs;
+	Paths _paths;             // Kept, with their find() index, for as long as the document is.
+	Definitions _definitions;
+	std::unique_ptr<char[]> _buffer; // Read buffer, kept between loads.
+	size_t _buffer_capacity = 0;
+
+	char* _ReserveBuffer(size_t len);
+	bool _Parse(simdjson::padded_string_view json);
+	bool _SetRoot(bool parsed);
 };
 
 // Synthesize a function name give a path and its verb.
 // Use this to get a C++-compatible function name when the globally unique operationId is unavailable.
 std::string SynthesizeFunctionName(std::string_view pathstr, RequestMethod verb);
 
+// Calls f(sink, key, value) for every member of map (e.g. paths(), definitions() or responses()) on up to
+// parallelism() threads. The members are cut into runs of consecutive members, a few per thread, which threads
+// claim one at a time until none are left, so threads that drew cheap members take over from the rest.
+// Every run gets its own default-constructed Sink, and the sinks are returned in document order: merging them
+// front to back gives what a sequential pass would, whatever the number of threads.
+// f must only read the document, which must stay loaded until this returns.
+template <typename Sink, typename T, typename F>
+std::vector<Sink> parallel_for_each(const __detail::MapAdaptor<T>& map, F&& f) {
+	const size_t count = map.size();
+	const size_t threads = std::min<size_t>(parallelism(), count);
+	const size_t runs = threads > 1 ? std::min(count, threads * 4) : 1;
+
+	// Iterating an object only skips over tape words, so finding where each run starts costs little.
+	std::vector<typename __detail::MapAdaptor<T>::Iterator> bounds;
+	bounds.reserve(runs + 1);
+	auto it = map.begin();
+	for (size_t run = 0, i = 0; run < runs; ++run) {
+		for (const size_t first = count * run / runs; i < first; ++i) {
+			++it;
+		}
+		bounds.push_back(it);
+	}
+	bounds.push_back(map.end());
+
+	std::vector<Sink> sinks(runs);
+	std::atomic<size_t> next = 0;
+	auto worker = [&] {
+		for (size_t run = next++; run < runs; run = next++) {
+			for (auto member = bounds[run]; member != bounds[run + 1]; ++member) {
+				const auto& [key, value] = *member;
+				f(sinks[run], key, value);
+			}
+		}
+	};
+	std::vector<std::future<void>> workers;
+	for (size_t t = 1; t < threads; ++t) {
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (auto& w : workers) {
+		w.get();
+	}
+	return sinks;
+}
+
 } // namespace openapi
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <simdjson.h>
+
+#include "openapi2.hpp"
+
+// Streaming front end built on simdjson::ondemand.
+// It mirrors the iteration shape of openapi2.hpp (paths(), operations(), parameters(), definitions()),
+// but never builds a DOM tape: values are decoded as the iteration reaches them.
+// The input is memory-mapped where possible, so resident memory is bounded by what the iteration touches.
+//
+// On-Demand is forward-only. Within one object, finish with a child (e.g. iterate all of parameters())
+// before asking for another field of the parent, and do not hold on to an object after moving past it.
+// Strings returned by any accessor remain valid until the next paths(), definitions() or Load.
+namespace openapi::ondemand {
+
+namespace __detail {
+
+template <typename T>
+inline T FromValue(simdjson::ondemand::value value) {
+	if constexpr (std::is_same_v<T, std::string_view>) {
+		std::string_view sv;
+		return value.get_string().get(sv) == simdjson::SUCCESS ? sv : std::string_view();
+	} else {
+		return T(value);
+	}
+}
+
+template <typename T>
+class ListAdaptor final {
+public:
+	class Iterator final {
+	public:
+		Iterator()
+			: _it(), _is_valid(false) {}
+		Iterator(simdjson::ondemand::array_iterator it)
+			: _it(it), _is_valid(true) {}
+		inline T operator*() {
+			simdjson::ondemand::value value;
+			return (*_it).get(value) == simdjson::SUCCESS ? FromValue<T>(value) : T();
+		}
+		inline Iterator& operator++() { ++_it; return *this; }
+		inline bool operator!=(const Iterator& other) const { return _is_valid && _it != other._it; }
+
+	private:
+		simdjson::ondemand::array_iterator _it;
+		bool _is_valid;
+	};
+	using iterator_type = Iterator;
+
+	ListAdaptor()
+		: _array(), _is_valid(false) {}
+	ListAdaptor(simdjson::ondemand::value value) {
+		_is_valid = value.get_array().get(_array) == simdjson::SUCCESS;
+	}
+	inline Iterator begin() {
+		simdjson::ondemand::array_iterator it;
+		return _is_valid && _array.begin().get(it) == simdjson::SUCCESS ? Iterator(it) : Iterator();
+	}
+	inline Iterator end() {
+		simdjson::ondemand::array_iterator it;
+		return _is_valid && _array.end().get(it) == simdjson::SUCCESS ? Iterator(it) : Iterator();
+	}
+
+private:
+	simdjson::ondemand::array _array;
+	bool _is_valid;
+};
+
+template <typename T>
+class MapAdaptor final {
+public:
+	class Iterator final {
+	public:
+		using value_type = std::pair<std::string_view, T>;
+		Iterator()
+			: _it(), _is_valid(false) {}
+		Iterator(simdjson::ondemand::object_iterator it)
+			: _it(it), _is_valid(true) {}
+		inline value_type operator*() {
+			simdjson::ondemand::field field;
+			std::string_view key;
+			if ((*_it).get(field) != simdjson::SUCCESS || field.unescaped_key().get(key) != simdjson::SUCCESS) {
+				return value_type{};
+			}
+			return value_type{key, FromValue<T>(field.value())};
+		}
+		inline Iterator& operator++() { ++_it; return *this; }
+		inline bool operator!=(const Iterator& other) const { return _is_valid && _it != other._it; }
+
+	private:
+		simdjson::ondemand::object_iterator _it;
+		bool _is_valid;
+	};
+	using iterator_type = Iterator;
+
+	MapAdaptor()
+		: _object(), _is_valid(false) {}
+	MapAdaptor(simdjson::ondemand::value value) {
+		_is_valid = value.get_object().get(_object) == simdjson::SUCCESS;
+	}
+	inline Iterator begin() {
+		simdjson::ondemand::object_iterator it;
+		return _is_valid && _object.begin().get(it) == simdjson::SUCCESS ? Iterator(it) : Iterator();
+	}
+	inline Iterator end() {
+		simdjson::ondemand::object_iterator it;
+		return _is_valid && _object.end().get(it) == simdjson::SUCCESS ? Iterator(it) : Iterator();
+	}
+
+private:
+	simdjson::ondemand::object _object;
+	bool _is_valid;
+};
+
+template <typename T>
+class OpenAPIObject {
+public:
+	OpenAPIObject()
+		: _json()
+		, _is_valid(false) {}
+	OpenAPIObject(simdjson::ondemand::value json)
+		: _json(json)
+		, _is_valid(true) {}
+
+	inline operator bool() const noexcept { return _is_valid; }
+
+protected:
+	template <typename U>
+	U _GetObjectIfExist(std::string_view key) const {
+		simdjson::ondemand::value v;
+		return _is_valid && _json[key].get(v) == simdjson::SUCCESS ? U(v) : U();
+	}
+	template <typename U>
+	U _GetValueIfExist(std::string_view key) const {
+		U v{};
+		return _is_valid && _json[key].get(v) == simdjson::SUCCESS ? v : U();
+	}
+
+	// On-Demand values advance as they are read, even through const accessors.
+	mutable simdjson::ondemand::value _json;
+	bool _is_valid;
+};
+
+} // namespace __detail
+
+using StringList = __detail::ListAdaptor<std::string_view>;
+
+struct Property : public __detail::OpenAPIObject<Property> {
+	using __detail::OpenAPIObject<Property>::OpenAPIObject;
+	std::string_view type() const;
+	std::string_view description() const;
+	std::string_view pattern() const;
+	std::string_view format() const;
+	std::string_view reference() const;
+	StringList enum_() const;
+	Property items() const;
+
+	using Properties = __detail::MapAdaptor<Property>;
+	Properties properties() const;
+};
+
+class Response : public __detail::OpenAPIObject<Response> {
+public:
+	using __detail::OpenAPIObject<Response>::OpenAPIObject;
+	std::string_view description() const;
+	Property schema() const;
+};
+
+class Parameter : public __detail::OpenAPIObject<Parameter> {
+public:
+	using __detail::OpenAPIObject<Parameter>::OpenAPIObject;
+	std::string_view name() const;
+	std::string_view in() const;
+	std::string_view description() const;
+	bool required() const;
+	std::string_view type() const;
+	std::string_view format() const;
+	Property schema() const;
+};
+
+class Operation : public __detail::OpenAPIObject<Operation> {
+public:
+	using __detail::OpenAPIObject<Operation>::OpenAPIObject;
+	std::string_view summary() const;
+	std::string_view description() const;
+	std::string_view operation_id() const;
+	bool deprecated() const;
+
+	using Responses = __detail::MapAdaptor<Response>;
+	Responses responses() const;
+
+	using Parameters = __detail::ListAdaptor<Parameter>;
+	Parameters parameters() const;
+
+	using Tags = __detail::ListAdaptor<std::string_view>;
+	Tags tags() const;
+};
+
+class Path : public __detail::OpenAPIObject<Path> {
+public:
+	using __detail::OpenAPIObject<Path>::OpenAPIObject;
+
+	using Operations = __detail::MapAdaptor<Operation>;
+	Operations operations() const { return _is_valid ? Operations(_json) : Operations(); }
+};
+
+class OpenAPI2 {
+public:
+	OpenAPI2() noexcept {}
+	OpenAPI2(const OpenAPI2&) = delete;
+
+	// Each call starts a new pass from the top of the document, invalidating objects from the previous one.
+	using Paths = __detail::MapAdaptor<Path>;
+	Paths paths();
+
+	using Definitions = __detail::MapAdaptor<Property>;
+	Definitions definitions();
+
+	// Should return false if the file cannot be read or is not a JSON document.
+	bool Load(const std::string& path);
+
+	// The buffer is parsed in place and must outlive this object (or the next Load).
+	bool Load(simdjson::padded_string_view json);
+
+private:
+	bool _Section(std::string_view key, simdjson::ondemand::value& value);
+
+	simdjson::ondemand::parser _parser;
+	simdjson::ondemand::document _doc;
+	openapi::__detail::PaddedMapping _mapping;
+	simdjson::padded_string _owned; // Only used if the file could not be mapped.
+	bool _is_valid = false;
+};
+
+} // namespace openapi::ondemand
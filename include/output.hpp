@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Stream buffer that appends to a list of fixed-size chunks, so growing it never copies what is already written.
+class ChunkedBuffer final : public std::streambuf {
+public:
+	static constexpr size_t kChunkSize = 64 * 1024;
+
+	ChunkedBuffer() = default;
+	ChunkedBuffer(ChunkedBuffer&& other) noexcept;
+	ChunkedBuffer& operator=(ChunkedBuffer&& other) noexcept;
+
+	size_t size() const noexcept;
+
+	// The written bytes, in order. Views are invalidated by the next write or clear().
+	std::vector<std::string_view> chunks() const;
+
+	// Drops the content and releases the memory.
+	void clear() noexcept;
+
+protected:
+	int_type overflow(int_type ch) override;
+	std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+private:
+	std::vector<std::unique_ptr<char[]>> _chunks; // Every chunk but the last is full.
+};
+
+// A generated source file. Content is buffered in memory and only written to disk on Commit()
+// (or destruction), and only if it differs from what the file already holds, so unchanged files keep their mtime.
+// A changed file is written to a temporary file with a single write and renamed over the old one, so readers
+// never see it half-written and the cost is a handful of syscalls per file however it was rendered.
+class OutputFile final : public std::ostream {
+public:
+	OutputFile();
+	explicit OutputFile(std::filesystem::path path);
+	OutputFile(OutputFile&& other);
+	OutputFile& operator=(OutputFile&& other); // Commits this file before taking over other.
+	~OutputFile();
+
+	// Returns false if the file had to be written but could not be.
+	bool Commit();
+
+	const std::filesystem::path& path() const noexcept { return _path; }
+
+private:
+	ChunkedBuffer _buffer;
+	std::filesystem::path _path;
+};
+
+struct OutputRecord {
+	std::filesystem::path path;
+	uint64_t hash; // fnv1a of the content.
+	size_t size;
+	bool written;  // False if the file on disk was already identical.
+};
+
+// Writes chunks to a temporary file next to path and renames it over path. Returns false, leaving path as it was,
+// if either step fails. OutputFile::Commit writes through this; it is also used for files that are not outputs.
+bool replace_file(const std::filesystem::path& path, const std::vector<std::string_view>& chunks);
+
+// Every OutputFile committed so far, in commit order. Thread-safe.
+std::vector<OutputRecord> committed_outputs();
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Deterministic automaton over UTF-8 bytes, compiled from a JSON Schema "pattern" (an ECMA-262 regular expression).
+// Generated validators run it as a table walk, one lookup per input byte, so no regex engine is needed at runtime.
+//
+// Supported: literals, '.', classes and their ranges, \d \w \s and their negations, groups, alternation,
+// greedy and lazy quantifiers, and '^' / '$' at the ends of the pattern's top-level alternatives. As in JSON Schema,
+// an unanchored side matches anywhere in the string. Backreferences, lookaround and word boundaries have no DFA equivalent.
+class PatternDfa {
+public:
+	static constexpr uint32_t kNoState = UINT32_MAX;
+
+	// Returns false if the pattern is malformed, uses an unsupported feature, or needs more than max_states states.
+	// The automaton is minimal and its start state is 0.
+	bool Compile(std::string_view pattern, size_t max_states = 1024);
+
+	bool Matches(std::string_view input) const noexcept;
+
+	inline size_t num_states() const noexcept { return _accepting.size(); }
+	inline size_t num_classes() const noexcept { return _num_classes; }
+
+	// Bytes that every state treats alike share a class; transitions are indexed by class, not by byte.
+	inline uint8_t byte_class(unsigned char c) const noexcept { return _classes[c]; }
+	inline uint32_t next(uint32_t state, uint8_t cls) const noexcept { return _transitions[state * _num_classes + cls]; }
+	inline bool accepting(uint32_t state) const noexcept { return _accepting[state]; }
+
+	// The state no input can leave without failing, or kNoState if there is none.
+	inline uint32_t dead_state() const noexcept { return _dead; }
+	// The accepting state no input can leave, e.g. after the prefix of an unanchored pattern. Or kNoState.
+	inline uint32_t accept_state() const noexcept { return _sink; }
+
+private:
+	std::array<uint8_t, 256> _classes{};
+	size_t _num_classes = 0;
+	std::vector<uint32_t> _transitions;
+	std::vector<uint8_t> _accepting;
+	uint32_t _dead = kNoState;
+	uint32_t _sink = kNoState;
+};
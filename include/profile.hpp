@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Per-phase cost of a generator run, for --profile. Phases must run one at a time, since bytes written and
+// peak memory are attributed to whichever phase is being measured.
+class Profile {
+public:
+	struct Phase {
+		std::string name;
+		double wall_ms = 0;
+		size_t bytes_written = 0; // Size of the files the phase produced, whether or not they changed on disk.
+		size_t files = 0;
+		size_t peak_rss = 0;      // High-water mark of resident memory during the phase, in bytes. 0 if unknown.
+	};
+
+	template <typename F>
+	void Measure(std::string_view name, F&& body) {
+		_Begin(name);
+		body();
+		_End();
+	}
+
+	// Extra values reported alongside the phases, e.g. document sizes. Written as JSON numbers and booleans.
+	void Set(std::string_view key, size_t value) { _counters.emplace_back(key, std::to_string(value)); }
+	void Set(std::string_view key, bool value) { _counters.emplace_back(key, value ? "true" : "false"); }
+
+	const std::vector<Phase>& phases() const noexcept { return _phases; }
+
+	void WriteJson(std::ostream& out) const;
+
+private:
+	std::vector<Phase> _phases;
+	std::vector<std::pair<std::string, std::string>> _counters; // Values as JSON text.
+	double _start_ms = 0;
+	size_t _start_outputs = 0;
+
+	void _Begin(std::string_view name);
+	void _End();
+};
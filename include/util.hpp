@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
 #include <string_view>
 
 void ltrim(std::string_view &s);
@@ -10,10 +14,30 @@ void trim(std::string_view &s);
 
 bool compare_ignore_case(std::string_view l, std::string_view r) noexcept;
 
+// Makes input a valid C++ identifier: characters outside [A-Za-z0-9_] become '_', keywords get a trailing '_'
+// and a leading digit a leading one. Distinct inputs can give the same identifier.
 void sanitize(std::string& input);
 
 std::string sanitize(std::string_view input);
 
 void write_multiline_comment(std::ostream& out, std::string_view comment, std::string_view indent = "");
 
-std::string transform_url_to_function_signature(std::string_view);
\ No newline at end of file
+std::string transform_url_to_function_signature(std::string_view);
+
+// Escapes text for use inside a C++ string literal.
+std::string cpp_escape(std::string_view text);
+
+// Escapes a single JSON Pointer reference token ('~' -> "~0", '/' -> "~1").
+std::string json_pointer_escape(std::string_view token);
+
+// Number of threads the generators may use. Defaults to 1.
+void set_parallelism(unsigned jobs);
+unsigned parallelism();
+
+// Calls render(out, i) for every i in [0, count). With parallelism() > 1 the range is split into contiguous
+// shards that are rendered concurrently into separate buffers and then written to out in order,
+// so the output is byte-identical to a sequential run.
+void render_sharded(std::ostream& out, size_t count, const std::function<void(std::ostream&, size_t)>& render);
+
+// 64-bit FNV-1a. Stable across platforms and runs, so it can be persisted.
+uint64_t fnv1a(std::string_view data, uint64_t hash = 14695981039346656037ull) noexcept;
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <simdjson.h>
+
+namespace openapi {
+
+// Parses a YAML document straight into doc, writing the tape simdjson's own parser writes for the equivalent JSON,
+// so a dom::element over it (and every accessor built on one) cannot tell the difference. No JSON text is produced.
+// Reuses doc's buffers when they are large enough, like dom::parser does.
+//
+// Covers the YAML that OpenAPI documents are written in: block and flow collections, plain, quoted and block
+// scalars, comments, anchors and aliases, and the core schema's null, bool, int and float scalars. Keys are
+// always strings, as in JSON. Merge keys ("<<") are kept as ordinary keys, and tags other than !!str are ignored.
+// Only the first document of a stream is read. On failure, error (if given) says where and why.
+bool ParseYaml(std::string_view yaml, simdjson::dom::document& doc, std::string* error = nullptr);
+
+} // namespace openapi
@@ -2,74 +2,975 @@
 #include <array>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <vector>
 
-#include "openapi2.hpp"
+#include "compiled_spec.hpp"
+#include "output.hpp"
 #include "util.hpp"
 
 namespace fs = std::filesystem;
 using namespace std::literals;
 
-void beast_server_hpp(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
-    auto out = std::ofstream(output / (input.stem().string() + "_server.hpp"));
+void router(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+
+namespace {
+
+// A path parameter as the server hands it to its handler, in the order it appears in the path template.
+struct ServerParam {
+    std::string_view key; // As spelled in the path template.
+    std::string name;
+    std::string type; // std::string_view unless the parameter is declared as a number or boolean.
+};
+
+std::vector<ServerParam> ServerParams(const openapi::CompiledSpec& spec, uint32_t op) {
+    std::vector<ServerParam> result;
+    std::string_view pathstr = spec.strings[spec.paths.name[spec.operations.path[op]]];
+    for (auto open = pathstr.find('{'); open != std::string_view::npos; open = pathstr.find('{')) {
+        const auto close = pathstr.find('}', open);
+        if (close == std::string_view::npos) {
+            break;
+        }
+        const auto name = pathstr.substr(open + 1, close - open - 1);
+        std::string type = "std::string_view";
+        for (auto param : spec.operations.parameters[op]) {
+            if (spec.strings[spec.parameters.name[param]] == name && spec.strings[spec.parameters.in[param]] == "path") {
+                const auto cpp_type = openapi::JsonTypeToCppType(spec.strings[spec.parameters.type[param]], spec.strings[spec.parameters.format[param]]);
+                if (cpp_type != "std::string" && cpp_type != "void*") {
+                    type = cpp_type;
+                }
+            }
+        }
+        result.push_back(ServerParam{name, sanitize(name), std::move(type)});
+        pathstr.remove_prefix(close + 1);
+    }
+    return result;
+}
+
+constexpr auto server_class = R"(// HTTP/1.1 server that scales across cores without sharing an accept queue: every thread runs its own
+// io_context with its own listening socket bound with SO_REUSEPORT, so the kernel spreads connections over them
+// and a connection stays on the thread that accepted it. Each connection keeps one read buffer, preallocated
+// to buffer_size, and one response object, both reused for every request on it.
+// Requests are routed with match_route and passed to the handlers declared below.
+class Server {
+public:
+	struct Options {
+		std::string address = "0.0.0.0";
+		unsigned short port = 8080;
+)"sv;
+
+constexpr auto server_options = R"(		unsigned threads = 0;       // 0 for one per core.
+		size_t buffer_size = 8192;  // Initial capacity of each connection's read buffer.
+		size_t body_limit = 1 << 20;
+		std::chrono::steady_clock::duration timeout = std::chrono::seconds(30);
+	};
+
+	explicit Server(Options options);
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	// Listens on every thread and blocks until Stop() is called. Returns false if no listener could be opened.
+	bool Run();
+
+	// Thread-safe.
+	void Stop();
+
+private:
+	Options _options;
+	std::vector<std::unique_ptr<boost::asio::io_context>> _contexts;
+};
+)"sv;
+
+constexpr auto server_impl = R"(namespace {
+
+template <typename T>
+bool ParseParam(std::string_view text, T& out) {
+	if constexpr (std::is_same_v<T, std::string_view>) {
+		out = text;
+		return true;
+	} else if constexpr (std::is_same_v<T, bool>) {
+		out = text == "true"sv;
+		return out || text == "false"sv;
+	} else {
+		const auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size();
+	}
+}
+
+inline int HexDigit(char c) {
+	return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+// Percent-decodes text, into scratch if there is anything to decode. In a query, '+' is a space.
+// Malformed escapes are kept as they are.
+inline std::string_view Decoded(std::string_view text, std::string& scratch, bool query) {
+	if (text.find('%') == std::string_view::npos && (!query || text.find('+') == std::string_view::npos)) {
+		return text;
+	}
+	scratch.clear();
+	for (size_t i = 0; i < text.size(); ++i) {
+		const int hi = text[i] == '%' && i + 2 < text.size() ? HexDigit(text[i + 1]) : -1;
+		const int lo = hi >= 0 ? HexDigit(text[i + 2]) : -1;
+		if (lo >= 0) {
+			scratch.push_back(static_cast<char>(hi * 16 + lo));
+			i += 2;
+		} else {
+			scratch.push_back(query && text[i] == '+' ? ' ' : text[i]);
+		}
+	}
+	return scratch;
+}
+
+// Raw value of the first query parameter called name. One without '=' has an empty value.
+inline bool FindQuery(std::string_view target, std::string_view name, std::string_view& value) {
+	const auto question = target.find('?');
+	if (question == std::string_view::npos) {
+		return false;
+	}
+	auto query = target.substr(question + 1, target.find('#', question) - question - 1);
+	while (!query.empty()) {
+		const auto pair = query.substr(0, query.find('&'));
+		query.remove_prefix(std::min(query.size(), pair.size() + 1));
+		const auto eq = pair.find('=');
+		if (pair.substr(0, eq) == name) {
+			value = eq == std::string_view::npos ? std::string_view() : pair.substr(eq + 1);
+			return true;
+		}
+	}
+	return false;
 }
 
-void beast_server_cpp(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
-    auto out = std::ofstream(output / (input.stem().string() + "_server.cpp"));
+inline bool FindHeader(const Request& req, std::string_view name, std::string_view& value) {
+	const auto it = req.find(beast::string_view(name.data(), name.size()));
+	if (it == req.end()) {
+		return false;
+	}
+	value = std::string_view(it->value().data(), it->value().size());
+	return true;
 }
 
-void beast_client_hpp(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
-    auto out = std::ofstream(output / (input.stem().string() + "_client.hpp"));
-    out << "#pragma once\n"
+void Status(Response& res, http::status status) {
+	res.result(status);
+	res.body().clear();
+}
+
+// Dispatch.
+void Dispatch(const Request& req, Response& res, std::string_view base_path);
+
+boost::asio::awaitable<void> Session(beast::tcp_stream stream, const Server::Options& options) {
+	beast::flat_buffer buffer;
+	buffer.reserve(options.buffer_size);
+	Response res;
+	beast::error_code ec;
+	for (;;) {
+		http::request_parser<http::string_body> parser;
+		parser.body_limit(options.body_limit);
+		stream.expires_after(options.timeout);
+		co_await http::async_read(stream, buffer, parser, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+		if (ec) {
+			break;
+		}
+		const auto& req = parser.get();
+		res.clear();
+		res.body().clear(); // Keeps its capacity.
+		res.result(http::status::ok);
+		res.version(req.version());
+		res.keep_alive(req.keep_alive());
+		Dispatch(req, res, options.base_path);
+		res.prepare_payload();
+		co_await http::async_write(stream, res, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+		if (ec || !res.keep_alive()) {
+			break;
+		}
+	}
+	stream.socket().shutdown(ip::tcp::socket::shutdown_send, ec);
+}
+
+boost::asio::awaitable<void> Listen(ip::tcp::acceptor acceptor, const Server::Options& options) {
+	for (;;) {
+		beast::error_code ec;
+		auto socket = co_await acceptor.async_accept(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+		if (ec == boost::asio::error::operation_aborted) {
+			co_return;
+		}
+		if (ec) {
+			continue;
+		}
+		socket.set_option(ip::tcp::no_delay(true), ec);
+		boost::asio::co_spawn(acceptor.get_executor(), Session(beast::tcp_stream(std::move(socket)), options), boost::asio::detached);
+	}
+}
+
+bool OpenListener(ip::tcp::acceptor& acceptor, const ip::tcp::endpoint& endpoint) {
+	beast::error_code ec;
+	acceptor.open(endpoint.protocol(), ec);
+	if (!ec) {
+		acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+	}
+#ifdef SO_REUSEPORT
+	if (!ec) {
+		acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+	}
+#endif
+	if (!ec) {
+		acceptor.bind(endpoint, ec);
+	}
+	if (!ec) {
+		acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+	}
+	return !ec;
+}
+
+} // namespace
+
+Server::Server(Options options)
+	: _options(std::move(options)) {
+	unsigned threads = _options.threads != 0 ? _options.threads : std::max(1u, std::thread::hardware_concurrency());
+#ifndef SO_REUSEPORT
+	threads = 1; // Listeners cannot share a port.
+#endif
+	for (unsigned i = 0; i < threads; ++i) {
+		// A concurrency hint of 1 lets Asio drop the locking it needs when several threads share a context.
+		_contexts.push_back(std::make_unique<boost::asio::io_context>(1));
+	}
+}
+
+bool Server::Run() {
+	const ip::tcp::endpoint endpoint(boost::asio::ip::make_address(_options.address), _options.port);
+	size_t listening = 0;
+	for (auto& ctx : _contexts) {
+		ip::tcp::acceptor acceptor(*ctx);
+		if (OpenListener(acceptor, endpoint)) {
+			boost::asio::co_spawn(*ctx, Listen(std::move(acceptor), _options), boost::asio::detached);
+			++listening;
+		}
+	}
+	if (listening == 0) {
+		return false;
+	}
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < _contexts.size(); ++i) {
+		threads.emplace_back([&ctx = *_contexts[i]] { ctx.run(); });
+	}
+	_contexts.front()->run();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	return true;
+}
+
+void Server::Stop() {
+	for (auto& ctx : _contexts) {
+		ctx->stop();
+	}
+}
+
+)"sv;
+
+} // namespace
+
+void beast_server_hpp(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+    auto out = OutputFile(output / (input.stem().string() + "_server.hpp"));
+    out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+        << "#pragma once\n"
+        << "#include <utility> // Some Boost.Asio versions use std::exchange without including it.\n"
+        << '\n'
+        << "#include <boost/asio/io_context.hpp>\n"
         << "#include <boost/beast/core.hpp>\n"
         << "#include <boost/beast/http.hpp>\n"
-        << "#include <boost/asio.hpp>\n"
-        << "#include <boost/asio/ip/tcp.hpp>\n"
-        << "#include <functional>\n"
+        << "#include <chrono>\n"
+        << "#include <cstdint>\n"
         << "#include <memory>\n"
         << "#include <string>\n"
         << "#include <string_view>\n"
+        << "#include <vector>\n"
+        << '\n'
+        << "#include \"" << input.stem().string() << "_defs.hpp\"\n"
         << '\n'
         << "namespace beast = boost::beast;\n"
-        << "namespace ip    = boost::asio::ip;\n"
-        << std::endl;
+        << "namespace http  = boost::beast::http;\n"
+        << '\n'
+        << "using Request = http::request<http::string_body>;\n"
+        << "using Response = http::response<http::string_body>;\n"
+        << '\n'
+        << server_class;
+    std::string_view base_path = spec.strings[spec.base_path];
+    if (base_path.ends_with('/')) {
+        base_path.remove_suffix(1);
+    }
+    out << "\t\tstd::string base_path = \"" << cpp_escape(base_path) << "\"; // Stripped from targets before routing.\n"
+        << server_options
+        << '\n'
+        << "// One handler per operation, to be implemented by the application. The response starts out as an empty 200.\n"
+        << "// Path parameters are passed in template order, converted to their declared type; others are in req.\n"
+        << "// Handlers run on the thread of the connection and must not block it.\n"
+        << "namespace handlers {\n"
+        << '\n';
 
-    std::string indent = "";
-    out << "class Client {\n";
-    indent.push_back('\t');
+    const auto& ops = spec.operations;
+    render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+        write_multiline_comment(out, spec.strings[ops.description[op]]);
+        out << "void " << spec.FunctionName(op) << "(const Request& req, Response& res";
+        for (const auto& param : ServerParams(spec, op)) {
+            out << ", " << param.type << ' ' << param.name;
+        }
+        out << ");\n\n";
+    });
+    out << "} // namespace handlers\n";
+}
 
-    for (const auto& [pathstr, path] : file.paths()) {
-        for (const auto& [optype, op] : path.operations()) {
-            write_multiline_comment(out, op.description(), indent);
-            if (!op.operation_id().empty()) {
-                out << indent << "void " << op.operation_id() << '(';
-            } else {
-                out << indent << "void " << openapi::SynthesizeFunctionName(pathstr, openapi::RequestMethodFromString(optype)) << '(';
+namespace {
+
+// Rejects a request with 400 before its handler runs if a required query or header parameter is missing, or if a
+// path, query or header parameter fails its validator. Validators see percent-decoded values.
+void WriteParameterChecks(std::ostream& out, const openapi::CompiledSpec& spec, uint32_t op, const std::vector<ServerParam>& path_params) {
+    bool has_value = false, has_scratch = false;
+    for (auto param : spec.operations.parameters[op]) {
+        const auto in = spec.strings[spec.parameters.in[param]];
+        const auto key = spec.strings[spec.parameters.name[param]];
+        const bool constrained = spec.IsConstrainedParameter(param);
+        const bool required = spec.parameters.required[param];
+        std::string condition;
+        if (in == "path") {
+            const auto it = std::find_if(path_params.begin(), path_params.end(), [key](const ServerParam& p) { return p.key == key; });
+            if (!constrained || it == path_params.end()) {
+                continue;
             }
-            for (const auto& param : op.parameters()) {
-                out << openapi::JsonTypeToCppType(qparam.type()) << ' ' << qparam.name() << ", ";
+            condition = "!" + spec.ParameterValidatorName(op, param) + "(Decoded(match.params[" + std::to_string(it - path_params.begin()) + "], scratch, false))";
+        } else if (in == "query" || in == "header") {
+            if (!constrained && !required) {
+                continue;
             }
-            if (!op.parameters().empty()) {
-                out.seekp(-2, std::ios::end);
+            const auto find = in == "query" ? "FindQuery(target, \"" + cpp_escape(key) + "\"sv, value)"
+                                            : "FindHeader(req, \"" + cpp_escape(key) + "\"sv, value)";
+            const auto check = spec.ParameterValidatorName(op, param) + (in == "query" ? "(Decoded(value, scratch, true))" : "(value)");
+            condition = !constrained ? "!" + find : required ? "!" + find + " || !" + check : find + " && !" + check;
+            if (!has_value) {
+                out << "\t\tstd::string_view value;\n";
+                has_value = true;
             }
-            out << ");\n";
-            out << std::endl;
+        } else {
+            continue;
+        }
+        if (constrained && in != "header" && !has_scratch) {
+            out << "\t\tstd::string scratch;\n";
+            has_scratch = true;
+        }
+        out << "\t\tif (" << condition << ") {\n"
+            << "\t\t\treturn Status(res, http::status::bad_request);\n"
+            << "\t\t}\n";
+    }
+}
+
+} // namespace
+
+void beast_server_cpp(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+    auto out = OutputFile(output / (input.stem().string() + "_server.cpp"));
+    out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+        << "#include \"" << input.stem().string() << "_server.hpp\"\n"
+        << "#include \"" << input.stem().string() << "_router.hpp\"\n"
+        << "#include \"" << input.stem().string() << "_validate.hpp\"\n"
+        << '\n'
+        << "#include <boost/asio/co_spawn.hpp>\n"
+        << "#include <boost/asio/detached.hpp>\n"
+        << "#include <boost/asio/ip/tcp.hpp>\n"
+        << "#include <boost/asio/redirect_error.hpp>\n"
+        << "#include <boost/asio/use_awaitable.hpp>\n"
+        << "#include <algorithm>\n"
+        << "#include <charconv>\n"
+        << "#include <thread>\n"
+        << "#include <type_traits>\n"
+        << '\n'
+        << "namespace ip = boost::asio::ip;\n"
+        << '\n'
+        << server_impl;
+
+    out << "namespace {\n"
+        << '\n'
+        << "void Dispatch(const Request& req, Response& res, std::string_view base_path) {\n"
+        << "\tconst auto method = req.method_string();\n"
+        << "\tstd::string_view target(req.target().data(), req.target().size());\n"
+        << "\tif (!target.starts_with(base_path)) {\n"
+        << "\t\treturn Status(res, http::status::not_found);\n"
+        << "\t}\n"
+        << "\ttarget.remove_prefix(base_path.size());\n"
+        << "\tconst auto match = match_route(method_from_string({method.data(), method.size()}), target);\n"
+        << "\tswitch (match.route) {\n";
+    const auto& ops = spec.operations;
+    render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+        const auto name = spec.FunctionName(op);
+        const auto params = ServerParams(spec, op);
+        out << "\tcase Route::" << name << ": {\n";
+        WriteParameterChecks(out, spec, op, params);
+        for (size_t i = 0; i < params.size(); ++i) {
+            out << "\t\t" << params[i].type << ' ' << params[i].name << "{};\n"
+                << "\t\tif (!ParseParam(match.params[" << i << "], " << params[i].name << ")) {\n"
+                << "\t\t\treturn Status(res, http::status::bad_request);\n"
+                << "\t\t}\n";
         }
+        out << "\t\treturn handlers::" << name << "(req, res";
+        for (const auto& param : params) {
+            out << ", " << param.name;
+        }
+        out << ");\n"
+            << "\t}\n";
+    });
+    out << "\tcase Route::MethodNotAllowed:\n"
+        << "\t\treturn Status(res, http::status::method_not_allowed);\n"
+        << "\tdefault:\n"
+        << "\t\treturn Status(res, http::status::not_found);\n"
+        << "\t}\n"
+        << "}\n"
+        << '\n'
+        << "} // namespace\n";
+}
+
+namespace {
+
+// Client-side view of a parameter: how it is passed to the generated method and where it goes in the request.
+struct ClientParam {
+    uint32_t id;
+    std::string name;     // Sanitized, used as the C++ parameter name.
+    std::string_view in;  // path, query, header, body or formData.
+    std::string type;     // C++ type in the method signature.
+    bool required;
+};
+
+std::string ClientParamType(const openapi::CompiledSpec& spec, uint32_t param) {
+    const auto& params = spec.parameters;
+    if (params.schema[param] != openapi::npos) {
+        // Bodies of a named definition are serialized with to_json; anything else is passed as JSON text.
+        const auto schema = params.schema[param];
+        if (spec.schemas.kind[schema] == openapi::JsonType::Reference && spec.schemas.target[schema] != openapi::npos) {
+            return "const " + std::string(spec.ReferenceTypeName(schema)) + '&';
+        }
+        return "std::string_view";
+    }
+    const auto type = spec.strings[params.type[param]];
+    if (type == "array") {
+        const auto items = params.items[param];
+        const auto item_type = items == openapi::npos || spec.strings[spec.schemas.type[items]] == "string"
+            ? std::string("std::string")
+            : spec.CppType(items, "");
+        return "const std::vector<" + item_type + ">&";
+    }
+    const auto cpp_type = openapi::JsonTypeToCppType(type, spec.strings[params.format[param]]);
+    return cpp_type == "std::string" || cpp_type == "void*" ? "std::string_view" : std::string(cpp_type);
+}
+
+// Required parameters first, in declaration order, then optional ones, which default to std::nullopt.
+std::vector<ClientParam> ClientParams(const openapi::CompiledSpec& spec, uint32_t op) {
+    std::vector<ClientParam> result;
+    for (auto param : spec.operations.parameters[op]) {
+        const auto in = spec.strings[spec.parameters.in[param]];
+        const bool required = spec.parameters.required[param] || in == "path";
+        result.push_back(ClientParam{param, sanitize(spec.strings[spec.parameters.name[param]]), in, ClientParamType(spec, param), required});
+    }
+    std::stable_partition(result.begin(), result.end(), [](const ClientParam& p) { return p.required; });
+    return result;
+}
+
+void WriteClientSignature(std::ostream& out, const std::vector<ClientParam>& params, bool declaration) {
+    for (size_t i = 0; i < params.size(); ++i) {
+        const auto& p = params[i];
+        out << (i == 0 ? "" : ", ");
+        if (p.required) {
+            out << p.type << ' ' << p.name;
+        } else {
+            // Optional parameters are held by value; a reference inside std::optional is not allowed.
+            auto type = p.type;
+            if (type.starts_with("const ") && type.ends_with("&")) {
+                type = type.substr(6, type.size() - 7);
+            }
+            out << "std::optional<" << type << "> " << p.name << (declaration ? " = std::nullopt" : "");
+        }
+    }
+}
+
+constexpr auto client_class = R"(// Asynchronous client for one host. Every operation is a coroutine sharing a pool of keep-alive connections,
+// so only the first requests pay for a TCP handshake. Once every pooled connection is busy, up to max_pipeline
+// requests are written ahead of their responses on each one (HTTP/1.1 pipelining).
+// Errors are thrown as boost::system::system_error. Idempotent requests that fail on a connection the server
+// has since closed are retried once on a new one.
+// Calls must be made on the executor the client was constructed with; on a multi-threaded io_context, use a strand.
+class Client {
+public:
+	using Request = http::request<http::string_body>;
+	using Response = http::response<http::string_body>;
+
+	struct Options {
+)"sv;
+
+constexpr auto client_options = R"(		size_t pool_size = 4;    // Connections kept open to the host.
+		size_t max_pipeline = 8; // Requests in flight on one connection; 1 disables pipelining.
+		std::chrono::steady_clock::duration timeout = std::chrono::seconds(30);
+	};
+
+	Client(boost::asio::any_io_executor executor, Options options);
+	Client(const Client&) = delete;
+	Client& operator=(const Client&) = delete;
+	~Client();
+
+)"sv;
+
+constexpr auto client_private = R"(private:
+	struct Connection;
+
+	Request _TakeRequest(http::verb method);
+	boost::asio::awaitable<Response> _Send(Request request, bool idempotent);
+	boost::asio::awaitable<std::shared_ptr<Connection>> _Acquire();
+	boost::asio::awaitable<void> _Exchange(Connection& conn, Request& request, Response& response, boost::system::error_code& ec);
+	boost::asio::awaitable<void> _AwaitTurn(Connection& conn, const uint64_t& counter, uint64_t ticket);
+	void _Break(Connection& conn);
+
+	boost::asio::any_io_executor _executor;
+	Options _options;
+	ip::tcp::resolver _resolver;
+	ip::tcp::resolver::results_type _endpoints;
+	std::vector<std::shared_ptr<Connection>> _pool;
+	size_t _connecting = 0;
+	boost::asio::steady_timer _available; // Never expires; cancelled whenever a connection frees up.
+	std::vector<Request> _spare;          // Sent requests, kept for the capacity of their buffers.
+	std::string _target;                  // Scratch space for building targets.
+};
+)"sv;
+
+constexpr auto client_impl = R"(namespace {
+
+bool IsUnreserved(char c) {
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+void AppendValue(std::string& out, std::string_view value) {
+	constexpr auto hex = "0123456789ABCDEF";
+	for (char c : value) {
+		if (IsUnreserved(c)) {
+			out.push_back(c);
+		} else {
+			const char escaped[] = {'%', hex[static_cast<unsigned char>(c) >> 4], hex[c & 0xf]};
+			out.append(escaped, sizeof(escaped));
+		}
+	}
+}
+
+inline void AppendValue(std::string& out, bool value) {
+	out.append(value ? "true"sv : "false"sv);
+}
+
+template <typename T>
+	requires std::is_arithmetic_v<T>
+void AppendValue(std::string& out, T value) {
+	char buf[32];
+	const auto result = std::to_chars(buf, buf + sizeof(buf), value);
+	out.append(buf, result.ptr - buf);
+}
+
+// Arrays use the default collectionFormat, csv.
+template <typename T>
+void AppendValue(std::string& out, const std::vector<T>& values) {
+	for (size_t i = 0; i < values.size(); ++i) {
+		if (i != 0) {
+			out.push_back(',');
+		}
+		AppendValue(out, values[i]);
+	}
+}
+
+template <typename T>
+std::string ToString(const T& value) {
+	std::string out;
+	AppendValue(out, value);
+	return out;
+}
+
+// Header values are not percent-encoded.
+inline std::string ToString(std::string_view value) {
+	return std::string(value);
+}
+
+} // namespace
+
+struct Client::Connection {
+	explicit Connection(boost::asio::any_io_executor executor)
+		: stream(executor), turn(executor, boost::asio::steady_timer::time_point::max()) {}
+
+	beast::tcp_stream stream;
+	beast::flat_buffer buffer;      // Reused by every response read on this connection.
+	boost::asio::steady_timer turn; // Never expires; cancelled to wake coroutines waiting for their turn.
+	uint64_t issued = 0;            // Tickets handed out, one per request.
+	uint64_t written = 0;           // Requests written; the ticket whose turn it is to write.
+	uint64_t read = 0;              // Responses read; the ticket whose turn it is to read.
+	bool broken = false;
+
+	size_t in_flight() const noexcept { return static_cast<size_t>(issued - read); }
+};
+
+Client::Client(boost::asio::any_io_executor executor, Options options)
+	: _executor(executor)
+	, _options(std::move(options))
+	, _resolver(executor)
+	, _available(executor, boost::asio::steady_timer::time_point::max()) {}
+
+Client::~Client() {
+	for (const auto& conn : _pool) {
+		beast::error_code ec;
+		conn->stream.socket().shutdown(ip::tcp::socket::shutdown_both, ec);
+	}
+}
+
+Client::Request Client::_TakeRequest(http::verb method) {
+	Request request;
+	if (!_spare.empty()) {
+		request = std::move(_spare.back());
+		_spare.pop_back();
+		request.clear();
+		request.body().clear(); // Keeps its capacity.
+	}
+	request.method(method);
+	request.version(11);
+	request.set(http::field::host, _options.host);
+	request.keep_alive(true);
+	return request;
+}
+
+boost::asio::awaitable<std::shared_ptr<Client::Connection>> Client::_Acquire() {
+	for (;;) {
+		std::erase_if(_pool, [](const auto& conn) { return conn->broken; });
+		std::shared_ptr<Connection> best;
+		for (const auto& conn : _pool) {
+			if (!best || conn->in_flight() < best->in_flight()) {
+				best = conn;
+			}
+		}
+		// An idle connection first, then a new one while the pool has room, then pipelining on the least loaded.
+		if (best && best->in_flight() == 0) {
+			co_return best;
+		}
+		if (_pool.size() + _connecting < _options.pool_size) {
+			++_connecting;
+			auto conn = std::make_shared<Connection>(_executor);
+			beast::error_code ec;
+			if (_endpoints.empty()) {
+				_endpoints = co_await _resolver.async_resolve(_options.host, _options.port, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+			}
+			if (!ec) {
+				conn->stream.expires_after(_options.timeout);
+				co_await conn->stream.async_connect(_endpoints, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+			}
+			--_connecting;
+			// Callers parked while this connect held a slot can go on either way: to connect themselves after a
+			// failure, or to pipeline on the new connection.
+			if (ec) {
+				_endpoints = {};
+				_available.cancel();
+				throw boost::system::system_error(ec);
+			}
+			conn->stream.socket().set_option(ip::tcp::no_delay(true));
+			_pool.push_back(conn);
+			_available.cancel();
+			co_return conn;
+		}
+		if (best && best->in_flight() < _options.max_pipeline) {
+			co_return best;
+		}
+		beast::error_code ec;
+		co_await _available.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+	}
+}
+
+boost::asio::awaitable<void> Client::_AwaitTurn(Connection& conn, const uint64_t& counter, uint64_t ticket) {
+	while (!conn.broken && counter != ticket) {
+		beast::error_code ec;
+		co_await conn.turn.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+	}
+}
+
+void Client::_Break(Connection& conn) {
+	if (conn.broken) {
+		return;
+	}
+	conn.broken = true;
+	beast::error_code ec;
+	conn.stream.socket().close(ec);
+	conn.turn.cancel();
+	_available.cancel();
+}
+
+// Writes and reads in ticket order, so a connection can carry several requests at once.
+boost::asio::awaitable<void> Client::_Exchange(Connection& conn, Request& request, Response& response, beast::error_code& ec) {
+	const uint64_t ticket = conn.issued++;
+	co_await _AwaitTurn(conn, conn.written, ticket);
+	if (conn.broken) {
+		ec = boost::asio::error::connection_aborted;
+		co_return;
+	}
+	conn.stream.expires_after(_options.timeout);
+	co_await http::async_write(conn.stream, request, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+	++conn.written;
+	conn.turn.cancel();
+	if (ec) {
+		_Break(conn);
+		co_return;
+	}
+
+	co_await _AwaitTurn(conn, conn.read, ticket);
+	if (conn.broken) {
+		ec = boost::asio::error::connection_aborted;
+		co_return;
+	}
+	conn.stream.expires_after(_options.timeout);
+	co_await http::async_read(conn.stream, conn.buffer, response, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+	++conn.read;
+	conn.turn.cancel();
+	if (ec || !response.keep_alive()) {
+		_Break(conn);
+	}
+	_available.cancel();
+}
+
+boost::asio::awaitable<Client::Response> Client::_Send(Request request, bool idempotent) {
+	request.prepare_payload();
+	for (int attempt = 0;; ++attempt) {
+		auto conn = co_await _Acquire();
+		const bool reused = conn->read != 0 || conn->issued != 0;
+		Response response;
+		beast::error_code ec;
+		co_await _Exchange(*conn, request, response, ec);
+		if (!ec) {
+			if (_spare.size() < _options.pool_size * _options.max_pipeline) {
+				_spare.push_back(std::move(request));
+			}
+			co_return response;
+		}
+		// A keep-alive connection may have been closed by the server while it sat in the pool.
+		if (attempt != 0 || !reused || !idempotent) {
+			throw boost::system::system_error(ec);
+		}
+	}
+}
+
+)"sv;
+
+} // namespace
+
+void beast_client_hpp(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+    auto out = OutputFile(output / (input.stem().string() + "_client.hpp"));
+    out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+        << "#pragma once\n"
+        << "#include <utility> // Some Boost.Asio versions use std::exchange without including it.\n"
+        << '\n'
+        << "#include <boost/asio/any_io_executor.hpp>\n"
+        << "#include <boost/asio/awaitable.hpp>\n"
+        << "#include <boost/asio/ip/tcp.hpp>\n"
+        << "#include <boost/asio/steady_timer.hpp>\n"
+        << "#include <boost/beast/core.hpp>\n"
+        << "#include <boost/beast/http.hpp>\n"
+        << "#include <chrono>\n"
+        << "#include <cstdint>\n"
+        << "#include <memory>\n"
+        << "#include <optional>\n"
+        << "#include <string>\n"
+        << "#include <string_view>\n"
+        << "#include <vector>\n"
+        << '\n'
+        << "#include \"" << input.stem().string() << "_defs.hpp\"\n"
+        << '\n'
+        << "namespace beast = boost::beast;\n"
+        << "namespace http  = boost::beast::http;\n"
+        << "namespace ip    = boost::asio::ip;\n"
+        << '\n'
+        << client_class;
+
+    // Defaults come from the spec's host ("name[:port]") and basePath.
+    std::string_view host = spec.strings[spec.host], port = "80";
+    if (const auto colon = host.rfind(':'); colon != std::string_view::npos && host.find(']', colon) == std::string_view::npos) {
+        port = host.substr(colon + 1);
+        host = host.substr(0, colon);
+    }
+    std::string_view base_path = spec.strings[spec.base_path];
+    if (base_path.ends_with('/')) {
+        base_path.remove_suffix(1); // Path templates start with '/'.
     }
+    out << "\t\tstd::string host = \"" << cpp_escape(host.empty() ? "localhost"sv : host) << "\";\n"
+        << "\t\tstd::string port = \"" << cpp_escape(port) << "\";\n"
+        << "\t\tstd::string base_path = \"" << cpp_escape(base_path) << "\";\n"
+        << client_options;
 
-    indent.pop_back();
-    out << "}; // class\n";
+    std::string indent = "\t";
+    const auto& ops = spec.operations;
+    render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+        write_multiline_comment(out, spec.strings[ops.description[op]], indent);
+        out << indent << "boost::asio::awaitable<Response> " << spec.FunctionName(op) << '(';
+        WriteClientSignature(out, ClientParams(spec, op), true);
+        out << ");\n\n";
+    });
+
+    out << client_private;
 }
 
-void beast_client_cpp(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
+void beast_client_cpp(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
     const auto header_path = output / (input.stem().string() + "_client.hpp");
-    auto out = std::ofstream(output / (input.stem().string() + "_client.cpp"));
-    out << "#include \"" << header_path.filename().string() << "\"\n";
+    auto out = OutputFile(output / (input.stem().string() + "_client.cpp"));
+    out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+        << "#include \"" << header_path.filename().string() << "\"\n"
+        << "#include \"" << input.stem().string() << "_to_json.hpp\"\n"
+        << '\n'
+        << "#include <boost/asio/connect.hpp>\n"
+        << "#include <boost/asio/redirect_error.hpp>\n"
+        << "#include <boost/asio/use_awaitable.hpp>\n"
+        << "#include <charconv>\n"
+        << "#include <type_traits>\n"
+        << '\n'
+        << "using namespace std::literals;\n"
+        << '\n'
+        << client_impl;
+
+    const auto& ops = spec.operations;
+    render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+        const auto params = ClientParams(spec, op);
+        const auto method = ops.method[op];
+        auto verb = std::string(openapi::RequestMethodToString(method));
+        if (verb == "delete") {
+            verb = "delete_";
+        }
+        const bool idempotent = method != openapi::RequestMethod::POST && method != openapi::RequestMethod::PATCH;
+        auto find = [&params](std::string_view in, std::string_view name) -> const ClientParam* {
+            for (const auto& p : params) {
+                if (p.in == in && p.name == name) {
+                    return &p;
+                }
+            }
+            return nullptr;
+        };
+
+        out << "boost::asio::awaitable<Client::Response> Client::" << spec.FunctionName(op) << '(';
+        WriteClientSignature(out, params, false);
+        out << ") {\n"
+            << "\tauto req_ = _TakeRequest(http::verb::" << verb << ");\n"
+            << "\t_target.assign(_options.base_path);\n";
+
+        // Literal parts of the template are copied as they are; {name} is replaced by the encoded parameter.
+        std::string_view pathstr = spec.strings[spec.paths.name[ops.path[op]]];
+        while (!pathstr.empty()) {
+            const auto open = pathstr.find('{');
+            const auto close = open == std::string_view::npos ? open : pathstr.find('}', open);
+            if (close == std::string_view::npos) {
+                out << "\t_target += \"" << cpp_escape(pathstr) << "\"sv;\n";
+                break;
+            }
+            if (open != 0) {
+                out << "\t_target += \"" << cpp_escape(pathstr.substr(0, open)) << "\"sv;\n";
+            }
+            const auto name = sanitize(pathstr.substr(open + 1, close - open - 1));
+            if (find("path", name)) {
+                out << "\tAppendValue(_target, " << name << ");\n";
+            } else {
+                out << "\t_target += \"" << cpp_escape(pathstr.substr(open, close - open + 1)) << "\"sv; // Not a declared parameter.\n";
+            }
+            pathstr.remove_prefix(close + 1);
+        }
+
+        bool has_query = false, has_form = false;
+        for (const auto& p : params) {
+            has_query |= p.in == "query";
+            has_form |= p.in == "formData";
+        }
+        if (has_query) {
+            out << "\tchar sep_ = '?';\n";
+        }
+        // Appends name=value pairs; separate(tab) writes whatever must precede each pair.
+        auto write_pairs = [&out, &params, &spec](std::string_view in, std::string_view dest, const auto& separate) {
+            for (const auto& p : params) {
+                if (p.in != in) {
+                    continue;
+                }
+                const auto key = cpp_escape(spec.strings[spec.parameters.name[p.id]]);
+                const auto value = p.required ? p.name : '*' + p.name;
+                std::string_view tab = "\t";
+                if (!p.required) {
+                    out << "\tif (" << p.name << ") {\n";
+                    tab = "\t\t";
+                }
+                separate(tab);
+                out << tab << dest << " += \"" << key << "=\"sv;\n"
+                    << tab << "AppendValue(" << dest << ", " << value << ");\n";
+                if (!p.required) {
+                    out << "\t}\n";
+                }
+            }
+        };
+        write_pairs("query", "_target", [&out](std::string_view tab) {
+            out << tab << "_target += sep_;\n"
+                << tab << "sep_ = '&';\n";
+        });
+        out << "\treq_.target(_target);\n";
+
+        for (const auto& p : params) {
+            if (p.in != "header") {
+                continue;
+            }
+            const auto key = cpp_escape(spec.strings[spec.parameters.name[p.id]]);
+            if (p.required) {
+                out << "\treq_.set(\"" << key << "\", ToString(" << p.name << "));\n";
+            } else {
+                out << "\tif (" << p.name << ") {\n"
+                    << "\t\treq_.set(\"" << key << "\", ToString(*" << p.name << "));\n"
+                    << "\t}\n";
+            }
+        }
+
+        for (const auto& p : params) {
+            if (p.in != "body") {
+                continue;
+            }
+            const auto value = p.required ? p.name : '*' + p.name;
+            const bool serialized = p.type.starts_with("const ");
+            std::string_view tab = "\t";
+            if (!p.required) {
+                out << "\tif (" << p.name << ") {\n";
+                tab = "\t\t";
+            }
+            out << tab << "req_.set(http::field::content_type, \"application/json\");\n";
+            if (serialized) {
+                out << tab << "to_json(req_.body(), " << value << ");\n";
+            } else {
+                out << tab << "req_.body().assign(" << value << ");\n";
+            }
+            if (!p.required) {
+                out << "\t}\n";
+            }
+        }
+        if (has_form) {
+            out << "\treq_.set(http::field::content_type, \"application/x-www-form-urlencoded\");\n";
+            write_pairs("formData", "req_.body()", [&out](std::string_view tab) {
+                out << tab << "if (!req_.body().empty()) {\n"
+                    << tab << "\treq_.body() += '&';\n"
+                    << tab << "}\n";
+            });
+        }
+        out << "\tco_return co_await _Send(std::move(req_), " << (idempotent ? "true" : "false") << ");\n"
+            << "}\n\n";
+    });
 }
 
-void beast(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
-    beast_server_hpp(input, output, file);
-    beast_server_cpp(input, output, file);
+void beast(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+    if (parallelism() > 1) {
+        // Each writer owns its output file, so they can run side by side.
+        auto server_hpp = std::async(std::launch::async, beast_server_hpp, std::cref(input), std::cref(output), std::cref(spec));
+        auto server_cpp = std::async(std::launch::async, beast_server_cpp, std::cref(input), std::cref(output), std::cref(spec));
+        auto client_cpp = std::async(std::launch::async, beast_client_cpp, std::cref(input), std::cref(output), std::cref(spec));
+        auto route = std::async(std::launch::async, router, std::cref(input), std::cref(output), std::cref(spec));
+        beast_client_hpp(input, output, spec);
+        route.get();
+        server_hpp.get();
+        server_cpp.get();
+        client_cpp.get();
+        return;
+    }
+    router(input, output, spec);
+    beast_server_hpp(input, output, spec);
+    beast_server_cpp(input, output, spec);
 
-    beast_client_hpp(input, output, file);
-    beast_client_cpp(input, output, file);
+    beast_client_hpp(input, output, spec);
+    beast_client_cpp(input, output, spec);
 }
@@ -3,7 +3,9 @@
 #include <filesystem>
 #include <fstream>
 
-#include "openapi2.hpp"
+#include "compiled_spec.hpp"
+#include "output.hpp"
+#include "util.hpp"
 
 namespace fs = std::filesystem;
 using namespace std::literals;
@@ -14,12 +16,12 @@ constexpr auto SupportedVerbs = std::array{
 };
 
 // Writes header and impl files for beauty.
-void beauty(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
+void beauty(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
     fs::path paths_header = output / (input.stem().string() + "_paths.hpp");
     fs::path paths_impl   = output / (input.stem().string() + "_paths.cpp");
 
     // Write the header file
-    std::ofstream out(paths_header);
+    OutputFile out(paths_header);
     out << "#pragma once\n"
         << "#include <beauty/beauty.hpp>\n"
         << '\n'
@@ -29,26 +31,27 @@ void beauty(const fs::path& input, const fs::path& output, openapi::OpenAPI2& fi
         << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
         << "// This file contains function prototypes for each path/requestmethod pair.\n"
         << "// Implement the function bodies for each prototype here.\n\n";
-    for (const auto& [pathstr, path] : file.paths()) {
-        for (const auto& [opstr, op] : path.operations()) {
+    for (uint32_t path = 0; path < spec.paths.size(); ++path) {
+        for ([[maybe_unused]] auto op : spec.paths.operations[path]) {
 
             out << ";\n\n";
         }
     }
     out << '\n'
         << "// Call this function to get an instance of a server object with all paths laid out.\n"
-        << "beauty::server add_routes();" << std::endl;
+        << "beauty::server add_routes();\n";
 
     // Write the server impl file
-    out = std::ofstream(paths_impl);
+    out = OutputFile(paths_impl);
     out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
         << "#include \"" << paths_header.filename().string() << "\"\n\n"
         << "beauty::server& add_routes(beauty::server& server) {\n";
 
     std::string function_name;
-    for (const auto& [pathstr, path] : file.paths()) {
-        out << "\tserver.add_route(\"" << pathstr << "\")\n";
-        for (const auto& [opstr, op] : path.operations()) {
+    render_sharded(out, spec.paths.size(), [&](std::ostream& out, size_t path) {
+        out << "\tserver.add_route(\"" << spec.strings[spec.paths.name[path]] << "\")\n";
+        for (auto op : spec.paths.operations[path]) {
+            const auto opstr = spec.strings[spec.operations.verb[op]];
             if (std::none_of(SupportedVerbs.begin(), SupportedVerbs.end(), [&opstr](std::string_view sv) {return sv == opstr;})) {
                 continue;
             }
@@ -57,10 +60,10 @@ void beauty(const fs::path& input, const fs::path& output, openapi::OpenAPI2& fi
                 opstr_ = "del";
             }
             out << "\t\t." << opstr_ << "([] (const Request& req, Response& res) {\n"
-                << "\t\t\t" << op.operation_id() << "(req, res);\n"
+                << "\t\t\t" << spec.strings[spec.operations.operation_id[op]] << "(req, res);\n"
                 << "\t\t});\n";
         }
-    }
+    });
     out << "\treturn server;\n"
-        << "}" << std::endl;
+        << "}\n";
 }
\ No newline at end of file
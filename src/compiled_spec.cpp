@@ -0,0 +1,1047 @@
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <unordered_set>
+
+#include "compiled_spec.hpp"
+#include "util.hpp"
+
+using namespace std::literals;
+
+namespace openapi {
+
+constexpr auto def_refstr = "#/definitions/"sv;
+
+namespace {
+
+// Adds every $ref reachable from json to reached, following each through refs the first time it is seen.
+// The views point into the document.
+void collect_references(const simdjson::dom::element& json, const ReferenceIndex& refs, std::unordered_set<std::string_view>& reached) {
+	std::vector<simdjson::dom::element> stack{json};
+	while (!stack.empty()) {
+		const auto element = stack.back();
+		stack.pop_back();
+		simdjson::dom::array arr;
+		simdjson::dom::object obj;
+		if (element.get(arr) == simdjson::SUCCESS) {
+			for (const auto& value : arr) {
+				stack.push_back(value);
+			}
+		} else if (element.get(obj) == simdjson::SUCCESS) {
+			for (const auto& [key, value] : obj) {
+				std::string_view ref;
+				if (key != "$ref" || value.get(ref) != simdjson::SUCCESS) {
+					stack.push_back(value);
+				} else if (reached.insert(ref).second) {
+					if (const auto* entry = refs.find(ref)) {
+						stack.push_back(entry->element);
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+
+bool Selection::Selects(const simdjson::dom::element& operation) const {
+	if (empty()) {
+		return true;
+	}
+	std::string_view operation_id;
+	if (operation["operationId"].get(operation_id) == simdjson::SUCCESS
+		&& std::find(operation_ids.begin(), operation_ids.end(), operation_id) != operation_ids.end()) {
+		return true;
+	}
+	simdjson::dom::array arr;
+	if (tags.empty() || operation["tags"].get(arr) != simdjson::SUCCESS) {
+		return false;
+	}
+	for (const auto& item : arr) {
+		std::string_view tag;
+		if (item.get(tag) == simdjson::SUCCESS && std::find(tags.begin(), tags.end(), tag) != tags.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string Selection::ToString() const {
+	if (empty()) {
+		return {};
+	}
+	auto sorted_tags = tags;
+	auto sorted_ids = operation_ids;
+	std::sort(sorted_tags.begin(), sorted_tags.end());
+	std::sort(sorted_ids.begin(), sorted_ids.end());
+	std::string text = "tags=";
+	for (const auto& tag : sorted_tags) {
+		text += cpp_escape(tag) + ',';
+	}
+	text += ";operations=";
+	for (const auto& id : sorted_ids) {
+		text += cpp_escape(id) + ',';
+	}
+	return text;
+}
+
+StringId StringPool::intern(std::string_view str) {
+	if (_ids.size() != _strings.size()) {
+		_ids.clear();
+		_ids.reserve(_strings.size());
+		for (size_t i = 0; i < _strings.size(); ++i) {
+			_ids.emplace(_strings[i], static_cast<StringId>(i));
+		}
+	}
+	auto it = _ids.find(str);
+	if (it != _ids.end()) {
+		return it->second;
+	}
+	const auto id = static_cast<StringId>(_strings.size());
+	std::string_view stored = _storage.emplace_back(str);
+	_strings.push_back(stored);
+	_ids.emplace(stored, id);
+	return id;
+}
+
+void StringPool::Adopt(std::vector<std::string_view> strings) {
+	_storage.clear();
+	_ids.clear();
+	_strings = std::move(strings);
+}
+
+StringId CompiledSpec::_Intern(const simdjson::dom::element& json) {
+	std::string_view sv;
+	return json.get(sv) == simdjson::SUCCESS ? strings.intern(sv) : 0;
+}
+
+Range CompiledSpec::_CompileStringList(const simdjson::dom::element& json) {
+	simdjson::dom::array arr;
+	if (json.get(arr) != simdjson::SUCCESS) {
+		return Range();
+	}
+	Range range{static_cast<uint32_t>(string_lists.size()), 0};
+	for (const auto& item : arr) {
+		string_lists.push_back(_Intern(item));
+		++range.count;
+	}
+	return range;
+}
+
+SchemaId CompiledSpec::_CompileSchema(const simdjson::dom::element& json) {
+	const auto id = static_cast<SchemaId>(schemas.size());
+	schemas.kind.push_back(JsonType::Primitive);
+	schemas.type.push_back(0);
+	schemas.format.push_back(0);
+	schemas.description.push_back(0);
+	schemas.pattern.push_back(0);
+	schemas.reference.push_back(0);
+	schemas.target.push_back(npos);
+	schemas.items.push_back(npos);
+	schemas.properties.push_back(Range());
+	schemas.enum_.push_back(Range());
+	schemas.required.push_back(Range());
+
+	simdjson::dom::object obj;
+	if (json.get(obj) != simdjson::SUCCESS) {
+		return id;
+	}
+	// Children are compiled recursively and append to the tables, so only index by id from here on.
+	for (const auto& [key, value] : obj) {
+		if (key == "type") {
+			schemas.type[id] = _Intern(value);
+		} else if (key == "format") {
+			schemas.format[id] = _Intern(value);
+		} else if (key == "description") {
+			schemas.description[id] = _Intern(value);
+		} else if (key == "pattern") {
+			schemas.pattern[id] = _Intern(value);
+		} else if (key == "$ref") {
+			schemas.reference[id] = _Intern(value);
+		} else if (key == "items") {
+			auto items = _CompileSchema(value);
+			schemas.items[id] = items;
+		} else if (key == "enum") {
+			auto range = _CompileStringList(value);
+			schemas.enum_[id] = range;
+		} else if (key == "required") {
+			auto range = _CompileStringList(value);
+			schemas.required[id] = range;
+		} else if (key == "properties") {
+			simdjson::dom::object props;
+			if (value.get(props) != simdjson::SUCCESS) {
+				continue;
+			}
+			std::vector<std::pair<StringId, SchemaId>> compiled;
+			compiled.reserve(props.size());
+			for (const auto& [propname, prop] : props) {
+				compiled.emplace_back(strings.intern(propname), _CompileSchema(prop));
+			}
+			schemas.properties[id] = Range{static_cast<uint32_t>(properties.size()), static_cast<uint32_t>(compiled.size())};
+			for (const auto& [propname, prop] : compiled) {
+				properties.name.push_back(propname);
+				properties.schema.push_back(prop);
+			}
+		}
+	}
+
+	const auto typestr = strings[schemas.type[id]];
+	if (strings[schemas.reference[id]].starts_with(def_refstr)) {
+		schemas.kind[id] = JsonType::Reference;
+	} else if (typestr == "object") {
+		schemas.kind[id] = JsonType::Object;
+	} else if (typestr == "array") {
+		schemas.kind[id] = JsonType::Array;
+	}
+	return id;
+}
+
+void CompiledSpec::_CompileParameter(const simdjson::dom::element& json, const ReferenceIndex& refs) {
+	simdjson::dom::object obj;
+	if (json.get(obj) != simdjson::SUCCESS) {
+		return;
+	}
+	std::string_view ref;
+	if (obj["$ref"].get(ref) == simdjson::SUCCESS) {
+		if (const auto* entry = refs.find(ref); entry && entry->element.get(obj) != simdjson::SUCCESS) {
+			return;
+		}
+	}
+	parameters.name.push_back(0);
+	parameters.in.push_back(0);
+	parameters.description.push_back(0);
+	parameters.type.push_back(0);
+	parameters.format.push_back(0);
+	parameters.pattern.push_back(0);
+	parameters.enum_.push_back(Range());
+	parameters.required.push_back(false);
+	parameters.schema.push_back(npos);
+	parameters.items.push_back(npos);
+	const auto id = parameters.size() - 1;
+	for (const auto& [key, value] : obj) {
+		if (key == "name") {
+			parameters.name[id] = _Intern(value);
+		} else if (key == "in") {
+			parameters.in[id] = _Intern(value);
+		} else if (key == "description") {
+			parameters.description[id] = _Intern(value);
+		} else if (key == "type") {
+			parameters.type[id] = _Intern(value);
+		} else if (key == "format") {
+			parameters.format[id] = _Intern(value);
+		} else if (key == "pattern") {
+			parameters.pattern[id] = _Intern(value);
+		} else if (key == "enum") {
+			auto range = _CompileStringList(value);
+			parameters.enum_[id] = range;
+		} else if (key == "required") {
+			bool required = false;
+			parameters.required[id] = value.get(required) == simdjson::SUCCESS && required;
+		} else if (key == "schema") {
+			auto schema = _CompileSchema(value);
+			parameters.schema[id] = schema;
+		} else if (key == "items") {
+			auto items = _CompileSchema(value);
+			parameters.items[id] = items;
+		}
+	}
+}
+
+void CompiledSpec::_CompileResponse(std::string_view code, const simdjson::dom::element& json, const ReferenceIndex& refs) {
+	simdjson::dom::object obj;
+	if (json.get(obj) != simdjson::SUCCESS) {
+		return;
+	}
+	std::string_view ref;
+	if (obj["$ref"].get(ref) == simdjson::SUCCESS) {
+		if (const auto* entry = refs.find(ref); entry && entry->element.get(obj) != simdjson::SUCCESS) {
+			return;
+		}
+	}
+	responses.code.push_back(strings.intern(code));
+	responses.description.push_back(0);
+	responses.schema.push_back(npos);
+	const auto id = responses.size() - 1;
+	for (const auto& [key, value] : obj) {
+		if (key == "description") {
+			responses.description[id] = _Intern(value);
+		} else if (key == "schema") {
+			auto schema = _CompileSchema(value);
+			responses.schema[id] = schema;
+		}
+	}
+}
+
+void CompiledSpec::_CompileOperation(uint32_t path, std::string_view verb, const simdjson::dom::element& json, const ReferenceIndex& refs) {
+	simdjson::dom::object obj;
+	if (json.get(obj) != simdjson::SUCCESS) {
+		return;
+	}
+	StringId operation_id = 0, summary = 0, description = 0;
+	bool deprecated = false;
+	Range params{static_cast<uint32_t>(parameters.size()), 0};
+	Range resps{static_cast<uint32_t>(responses.size()), 0};
+	Range tags;
+	for (const auto& [key, value] : obj) {
+		if (key == "operationId") {
+			operation_id = _Intern(value);
+		} else if (key == "summary") {
+			summary = _Intern(value);
+		} else if (key == "description") {
+			description = _Intern(value);
+		} else if (key == "deprecated") {
+			deprecated = value.get(deprecated) == simdjson::SUCCESS && deprecated;
+		} else if (key == "tags") {
+			tags = _CompileStringList(value);
+		} else if (key == "parameters") {
+			simdjson::dom::array arr;
+			if (value.get(arr) == simdjson::SUCCESS) {
+				params.first = static_cast<uint32_t>(parameters.size());
+				for (const auto& param : arr) {
+					_CompileParameter(param, refs);
+				}
+				params.count = static_cast<uint32_t>(parameters.size()) - params.first;
+			}
+		} else if (key == "responses") {
+			simdjson::dom::object resps_obj;
+			if (value.get(resps_obj) == simdjson::SUCCESS) {
+				resps.first = static_cast<uint32_t>(responses.size());
+				for (const auto& [code, resp] : resps_obj) {
+					_CompileResponse(code, resp, refs);
+				}
+				resps.count = static_cast<uint32_t>(responses.size()) - resps.first;
+			}
+		}
+	}
+	operations.path.push_back(path);
+	operations.method.push_back(RequestMethodFromString(verb));
+	operations.verb.push_back(strings.intern(verb));
+	operations.operation_id.push_back(operation_id);
+	operations.function_name.push_back(strings.intern(sanitize(operation_id != 0 ? std::string(strings[operation_id])
+		: SynthesizeFunctionName(strings[paths.name[path]], operations.method.back()))));
+	operations.summary.push_back(summary);
+	operations.description.push_back(description);
+	operations.deprecated.push_back(deprecated);
+	operations.parameters.push_back(params);
+	operations.responses.push_back(resps);
+	operations.tags.push_back(tags);
+}
+
+void CompiledSpec::Compile(const OpenAPI2& file, const Selection& selection) {
+	*this = CompiledSpec();
+	const auto& refs = file.references();
+	simdjson::dom::object root;
+	if (file.root().get(root) != simdjson::SUCCESS) {
+		return;
+	}
+
+	simdjson::dom::element value;
+	if (root["host"].get(value) == simdjson::SUCCESS) {
+		host = _Intern(value);
+	}
+	if (root["basePath"].get(value) == simdjson::SUCCESS) {
+		base_path = _Intern(value);
+	}
+
+	// Selected operations of each path item. Without a selection, path items without operations are kept too.
+	struct SelectedPath {
+		std::string_view name;
+		std::vector<std::pair<std::string_view, simdjson::dom::element>> operations; // Verb and operation.
+	};
+	std::vector<SelectedPath> selected;
+	simdjson::dom::object paths_obj;
+	if (root["paths"].get(paths_obj) == simdjson::SUCCESS) {
+		selected.reserve(paths_obj.size());
+		for (const auto& [pathstr, path] : paths_obj) {
+			auto& ops = selected.emplace_back(SelectedPath{pathstr, {}}).operations;
+			simdjson::dom::object path_obj;
+			if (path.get(path_obj) == simdjson::SUCCESS) {
+				for (const auto& [verb, op] : path_obj) {
+					// Path items may also carry "parameters" and "$ref", which are not operations.
+					if (RequestMethodFromString(verb) != RequestMethod::UNKNOWN && selection.Selects(op)) {
+						ops.emplace_back(verb, op);
+					}
+				}
+			}
+			if (!selection.empty() && ops.empty()) {
+				selected.pop_back();
+			}
+		}
+	}
+
+	// A selection keeps the definitions in the $ref closure of its operations, which are all that can be named.
+	std::unordered_set<std::string_view> reached;
+	if (!selection.empty()) {
+		for (const auto& path : selected) {
+			for (const auto& [verb, op] : path.operations) {
+				collect_references(op, refs, reached);
+			}
+		}
+	}
+
+	std::unordered_map<StringId, DefinitionId> by_pointer;
+	simdjson::dom::object defs;
+	if (root["definitions"].get(defs) == simdjson::SUCCESS) {
+		by_pointer.reserve(defs.size());
+		for (const auto& [name, def] : defs) {
+			auto pointer = std::string(def_refstr) + json_pointer_escape(name);
+			if (!selection.empty() && !reached.contains(pointer)) {
+				continue;
+			}
+			const auto id = static_cast<DefinitionId>(definitions.size());
+			definitions.name.push_back(strings.intern(name));
+			definitions.type_name.push_back(strings.intern(sanitize(name)));
+			definitions.schema.push_back(_CompileSchema(def));
+			by_pointer.emplace(strings.intern(pointer), id);
+		}
+	}
+
+	for (const auto& path : selected) {
+		const auto id = static_cast<uint32_t>(paths.size());
+		paths.name.push_back(strings.intern(path.name));
+		Range range{static_cast<uint32_t>(operations.size()), 0};
+		for (const auto& [verb, op] : path.operations) {
+			_CompileOperation(id, verb, op, refs);
+		}
+		range.count = static_cast<uint32_t>(operations.size()) - range.first;
+		paths.operations.push_back(range);
+	}
+
+	_UniqueNames(definitions.type_name);
+	_UniqueNames(operations.function_name);
+
+	// Schemas may refer to definitions that come later, so resolve once everything is compiled.
+	for (SchemaId id = 0; id < schemas.size(); ++id) {
+		if (schemas.kind[id] == JsonType::Reference) {
+			auto it = by_pointer.find(schemas.reference[id]);
+			schemas.target[id] = it != by_pointer.end() ? it->second : npos;
+		}
+	}
+	_ShareInlineTypes();
+}
+
+std::vector<std::string> CompiledSpec::UnmatchedSelectors(const Selection& selection) const {
+	std::vector<std::string> unmatched;
+	for (const auto& tag : selection.tags) {
+		bool matched = false;
+		for (uint32_t op = 0; op < operations.size() && !matched; ++op) {
+			for (auto i : operations.tags[op]) {
+				matched = matched || strings[string_lists[i]] == tag;
+			}
+		}
+		if (!matched) {
+			unmatched.push_back("--tag " + tag);
+		}
+	}
+	for (const auto& id : selection.operation_ids) {
+		bool matched = false;
+		for (uint32_t op = 0; op < operations.size() && !matched; ++op) {
+			matched = operations.operation_id[op] != 0 && strings[operations.operation_id[op]] == id;
+		}
+		if (!matched) {
+			unmatched.push_back("--operation " + id);
+		}
+	}
+	return unmatched;
+}
+
+// Hash-conses the schema tree: schemas with equal shapes get the same class, where a shape is everything that
+// affects the generated type and its (de)serializers, so descriptions are left out. Classes are numbered bottom-up
+// and keyed by the classes of their children, so each key is only as long as the node itself.
+// Only shapes free of $ref are shared: their declarations can go ahead of every definition.
+void CompiledSpec::_ShareInlineTypes() {
+	std::vector<uint32_t> shape(schemas.size(), npos);
+	std::vector<uint8_t> closed; // Per class.
+	std::unordered_map<std::string, uint32_t> classes;
+	std::string key;
+	std::function<uint32_t(SchemaId)> classify = [&](SchemaId id) -> uint32_t {
+		if (shape[id] != npos) {
+			return shape[id];
+		}
+		std::vector<uint32_t> fields{static_cast<uint32_t>(schemas.kind[id]), schemas.type[id], schemas.format[id], schemas.pattern[id],
+			schemas.kind[id] == JsonType::Reference ? schemas.reference[id] : 0};
+		bool is_closed = schemas.kind[id] != JsonType::Reference;
+		if (schemas.items[id] != npos) {
+			const auto items = classify(schemas.items[id]);
+			fields.push_back(items);
+			is_closed = is_closed && closed[items];
+		}
+		for (auto prop : schemas.properties[id]) {
+			const auto child = classify(properties.schema[prop]);
+			fields.push_back(properties.name[prop]);
+			fields.push_back(child);
+			is_closed = is_closed && closed[child];
+		}
+		// Lengths keep the lists apart, e.g. a property named like an enum value.
+		fields.push_back(schemas.enum_[id].count);
+		for (auto i : schemas.enum_[id]) {
+			fields.push_back(string_lists[i]);
+		}
+		fields.push_back(schemas.required[id].count);
+		for (auto i : schemas.required[id]) {
+			fields.push_back(string_lists[i]);
+		}
+		key.assign(reinterpret_cast<const char*>(fields.data()), fields.size() * sizeof(uint32_t));
+		const auto [it, inserted] = classes.try_emplace(key, static_cast<uint32_t>(classes.size()));
+		if (inserted) {
+			closed.push_back(is_closed);
+		}
+		return shape[id] = it->second;
+	};
+	for (SchemaId id = 0; id < schemas.size(); ++id) {
+		classify(id);
+	}
+
+	// Count the bodies PrintSchema would write for each class. Below a closed shape seen before, everything
+	// would repeat what its first occurrence wrote, so only the first is walked.
+	std::vector<uint32_t> count(classes.size(), 0);
+	std::vector<SchemaId> first(classes.size(), npos);
+	std::vector<StringId> first_name(classes.size(), 0);
+	const auto names_type = [this](SchemaId id) {
+		return schemas.kind[id] == JsonType::Object || IsEnum(id);
+	};
+	std::function<void(SchemaId, StringId, bool)> count_types = [&](SchemaId id, StringId name, bool root) {
+		if (id == npos) {
+			return;
+		}
+		if (schemas.kind[id] == JsonType::Array) {
+			return count_types(schemas.items[id], name, false);
+		}
+		if (!names_type(id)) {
+			return;
+		}
+		const auto cls = shape[id];
+		if (!root && count[cls]++ == 0) {
+			first[cls] = id;
+			first_name[cls] = name;
+		} else if (!root && closed[cls]) {
+			return;
+		}
+		for (auto prop : schemas.properties[id]) {
+			count_types(properties.schema[prop], properties.name[prop], false);
+		}
+	};
+	for (DefinitionId def = 0; def < definitions.size(); ++def) {
+		count_types(definitions.schema[def], definitions.name[def], true);
+	}
+
+	// Declare shared types children first, since a shared struct may alias another.
+	std::vector<uint32_t> class_index(classes.size(), npos);
+	std::unordered_map<std::string, uint32_t> used_names;
+	std::function<void(SchemaId, bool)> declare = [&](SchemaId id, bool root) {
+		if (id == npos) {
+			return;
+		}
+		if (schemas.kind[id] == JsonType::Array) {
+			return declare(schemas.items[id], false);
+		}
+		if (!names_type(id)) {
+			return;
+		}
+		const auto cls = shape[id];
+		const bool share = !root && closed[cls] && count[cls] > 1;
+		if (share && class_index[cls] != npos) {
+			return;
+		}
+		for (auto prop : schemas.properties[id]) {
+			declare(properties.schema[prop], false);
+		}
+		if (share) {
+			auto name = NestedTypeName(strings[first_name[cls]]);
+			if (const auto n = used_names[name]++; n > 0) {
+				name += std::to_string(n + 1);
+			}
+			class_index[cls] = static_cast<uint32_t>(shared_types.size());
+			shared_types.schema.push_back(first[cls]);
+			shared_types.name.push_back(strings.intern(name));
+		}
+	};
+	for (DefinitionId def = 0; def < definitions.size(); ++def) {
+		declare(definitions.schema[def], true);
+	}
+
+	shared.resize(schemas.size());
+	for (SchemaId id = 0; id < schemas.size(); ++id) {
+		shared[id] = class_index[shape[id]];
+	}
+	for (DefinitionId def = 0; def < definitions.size(); ++def) {
+		shared[definitions.schema[def]] = npos; // Definitions keep their own name.
+	}
+}
+
+// Sanitizing can map distinct names to one identifier. Later ones get the first free suffix, in table order.
+void CompiledSpec::_UniqueNames(std::vector<StringId>& names) {
+	std::unordered_set<StringId> taken(names.begin(), names.end());
+	std::unordered_set<StringId> seen;
+	for (auto& name : names) {
+		if (seen.insert(name).second) {
+			continue;
+		}
+		for (size_t n = 2;; ++n) {
+			const auto candidate = strings.intern(std::string(strings[name]) + '_' + std::to_string(n));
+			if (taken.insert(candidate).second) {
+				name = candidate;
+				seen.insert(candidate);
+				break;
+			}
+		}
+	}
+}
+
+std::string CompiledSpec::FunctionName(uint32_t op) const {
+	return std::string(strings[operations.function_name[op]]);
+}
+
+std::string_view CompiledSpec::ReferenceTypeName(SchemaId id) const {
+	if (schemas.target[id] != npos) {
+		return strings[definitions.type_name[schemas.target[id]]];
+	}
+	return strings[schemas.reference[id]].substr(def_refstr.size());
+}
+
+std::string CompiledSpec::CppType(SchemaId id, std::string_view nested_name) const {
+	if (id == npos) {
+		return std::string(JsonTypeToCppType(""));
+	}
+	switch (schemas.kind[id]) {
+	case JsonType::Reference: return std::string(ReferenceTypeName(id));
+	case JsonType::Object:    return std::string(nested_name);
+	case JsonType::Array:     return (pmr ? "std::pmr::vector<" : "std::vector<") + CppType(schemas.items[id], nested_name) + '>';
+	default: break;
+	}
+	if (IsEnum(id)) {
+		return std::string(nested_name);
+	}
+	const auto type = JsonTypeToCppType(strings[schemas.type[id]], strings[schemas.format[id]]);
+	return pmr && type == "std::string" ? "std::pmr::string" : std::string(type);
+}
+
+bool CompiledSpec::UsesAllocator(SchemaId id, int depth) const {
+	// Containment through references cannot be circular in valid C++; the depth only guards against bad input.
+	if (!pmr || id == npos || depth > 64) {
+		return false;
+	}
+	switch (schemas.kind[id]) {
+	case JsonType::Array:
+		return true;
+	case JsonType::Reference:
+		return schemas.target[id] != npos && UsesAllocator(definitions.schema[schemas.target[id]], depth + 1);
+	case JsonType::Object:
+		for (auto prop : schemas.properties[id]) {
+			if (UsesAllocator(properties.schema[prop], depth + 1)) {
+				return true;
+			}
+		}
+		return false;
+	default:
+		return !IsEnum(id) && JsonTypeToCppType(strings[schemas.type[id]], strings[schemas.format[id]]) == "std::string";
+	}
+}
+
+bool CompiledSpec::IsEnum(SchemaId id) const {
+	return id != npos && schemas.kind[id] == JsonType::Primitive && strings[schemas.type[id]] == "string" && !schemas.enum_[id].empty();
+}
+
+std::vector<std::string> CompiledSpec::EnumeratorNames(SchemaId id) const {
+	std::vector<std::string> names;
+	for (auto i : schemas.enum_[id]) {
+		std::string name(strings[string_lists[i]]);
+		std::replace_if(name.begin(), name.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '_'; }, '_');
+		if (name.empty()) {
+			name = "_";
+		}
+		sanitize(name);
+		// Values that only differ in punctuation would collide.
+		const auto base = name;
+		for (size_t n = 1; std::find(names.begin(), names.end(), name) != names.end(); ++n) {
+			name = base + '_' + std::to_string(n);
+		}
+		names.push_back(std::move(name));
+	}
+	return names;
+}
+
+void CompiledSpec::PrintEnumConversions(std::ostream& out, SchemaId id, const std::string& qualified) const {
+	const auto names = EnumeratorNames(id);
+	out << "constexpr std::string_view enum_to_string(" << qualified << " v) noexcept {\n"
+		<< "\tconstexpr std::string_view names[] = {";
+	std::map<size_t, std::vector<uint32_t>> by_length;
+	for (uint32_t i = 0; i < names.size(); ++i) {
+		const auto value = strings[string_lists[schemas.enum_[id].first + i]];
+		out << (i == 0 ? "" : ", ") << '"' << cpp_escape(value) << "\"sv";
+		by_length[value.size()].push_back(i);
+	}
+	out << "};\n"
+		<< "\treturn names[static_cast<size_t>(v)];\n"
+		<< "}\n"
+		<< '\n'
+		<< "constexpr bool enum_from_string(std::string_view s, " << qualified << "& out) noexcept {\n"
+		<< "\tswitch (s.size()) {\n";
+	for (const auto& [len, values] : by_length) {
+		out << "\tcase " << len << ":\n";
+		for (auto i : values) {
+			out << "\t\tif (s == \"" << cpp_escape(strings[string_lists[schemas.enum_[id].first + i]]) << "\"sv) {\n"
+				<< "\t\t\tout = " << qualified << "::" << names[i] << ";\n"
+				<< "\t\t\treturn true;\n"
+				<< "\t\t}\n";
+		}
+		out << "\t\treturn false;\n";
+	}
+	out << "\tdefault:\n"
+		<< "\t\treturn false;\n"
+		<< "\t}\n"
+		<< "}\n"
+		<< '\n';
+}
+
+bool CompiledSpec::IsConstrainedString(SchemaId id) const {
+	return id != npos && schemas.kind[id] == JsonType::Primitive && strings[schemas.type[id]] == "string"
+		&& schemas.pattern[id] != 0 && !IsEnum(id);
+}
+
+bool CompiledSpec::IsConstrainedParameter(uint32_t param) const {
+	return parameters.schema[param] == npos && strings[parameters.type[param]] == "string"
+		&& (parameters.pattern[param] != 0 || !parameters.enum_[param].empty());
+}
+
+std::string CompiledSpec::ParameterValidatorName(uint32_t op, uint32_t param) const {
+	return "validate_" + FunctionName(op) + '_' + sanitize(strings[parameters.name[param]]);
+}
+
+// Visits every object and enum schema that gets a named C++ type, with the name PrintSchema gives it.
+// With only set, visits just the types of that definition, or of the shared types if it is npos.
+void CompiledSpec::_ForEachNamedType(const std::function<void(SchemaId, const std::string&)>& visit, DefinitionId only) const {
+	std::function<void(SchemaId, const std::string&, bool)> walk = [&](SchemaId id, const std::string& qualified, bool declared) {
+		if (id == npos) {
+			return;
+		}
+		if (schemas.kind[id] == JsonType::Array) {
+			walk(schemas.items[id], qualified, false);
+		} else if (!declared && shared[id] != npos) {
+			return; // An alias; the shared type is visited on its own.
+		} else if (schemas.kind[id] == JsonType::Object) {
+			visit(id, qualified);
+			for (auto prop : schemas.properties[id]) {
+				walk(properties.schema[prop], qualified + "::" + NestedTypeName(strings[properties.name[prop]]), false);
+			}
+		} else if (IsEnum(id)) {
+			visit(id, qualified);
+		}
+	};
+	for (size_t i = 0; i < shared_types.size() && (only == kAllDefinitions || only == npos); ++i) {
+		walk(shared_types.schema[i], "shared_types::" + std::string(strings[shared_types.name[i]]), true);
+	}
+	for (DefinitionId def = 0; def < definitions.size(); ++def) {
+		if (only != kAllDefinitions && only != def) {
+			continue;
+		}
+		const auto name = strings[definitions.type_name[def]];
+		const auto id = definitions.schema[def];
+		walk(id, schemas.kind[id] == JsonType::Object || IsEnum(id) ? std::string(name) : NestedTypeName(name), false);
+	}
+}
+
+void CompiledSpec::ForEachStruct(const std::function<void(SchemaId, const std::string&)>& visit) const {
+	_ForEachNamedType([&](SchemaId id, const std::string& qualified) {
+		if (schemas.kind[id] == JsonType::Object) {
+			visit(id, qualified);
+		}
+	});
+}
+
+void CompiledSpec::ForEachEnum(const std::function<void(SchemaId, const std::string&)>& visit) const {
+	_ForEachNamedType([&](SchemaId id, const std::string& qualified) {
+		if (IsEnum(id)) {
+			visit(id, qualified);
+		}
+	});
+}
+
+void CompiledSpec::ForEachEnumOf(DefinitionId def, const std::function<void(SchemaId, const std::string&)>& visit) const {
+	_ForEachNamedType([&](SchemaId id, const std::string& qualified) {
+		if (IsEnum(id)) {
+			visit(id, qualified);
+		}
+	}, def);
+}
+
+// Walks the schemas PrintSchema writes for a definition, without entering shared types, which it only aliases.
+void CompiledSpec::_ForEachDeclaredSchema(DefinitionId def, const std::function<void(SchemaId)>& visit) const {
+	std::vector<SchemaId> stack{definitions.schema[def]};
+	while (!stack.empty()) {
+		const auto id = stack.back();
+		stack.pop_back();
+		if (id == npos) {
+			continue;
+		}
+		visit(id);
+		if (shared[id] != npos) {
+			continue;
+		}
+		if (schemas.items[id] != npos) {
+			stack.push_back(schemas.items[id]);
+		}
+		for (auto prop : schemas.properties[id]) {
+			stack.push_back(properties.schema[prop]);
+		}
+	}
+}
+
+std::vector<DefinitionId> CompiledSpec::References(DefinitionId def) const {
+	std::vector<DefinitionId> refs;
+	_ForEachDeclaredSchema(def, [&](SchemaId id) {
+		const auto target = schemas.target[id];
+		if (target != npos && target != def && std::find(refs.begin(), refs.end(), target) == refs.end()) {
+			refs.push_back(target);
+		}
+	});
+	return refs;
+}
+
+bool CompiledSpec::UsesSharedTypes(DefinitionId def) const {
+	bool uses = false;
+	_ForEachDeclaredSchema(def, [&](SchemaId id) {
+		uses = uses || shared[id] != npos;
+	});
+	return uses;
+}
+
+// The definitions that must be declared ahead of def. A reference that is an array's items, or an alias, only
+// needs its target declared, which the forward declaration of a struct is; any other needs it complete.
+// Aliases and enums have no forward declaration in the views, so they are always needed.
+std::vector<DefinitionId> CompiledSpec::_Dependencies(DefinitionId def) const {
+	std::vector<DefinitionId> deps;
+	std::vector<std::pair<SchemaId, bool>> stack{{definitions.schema[def], true}}; // With whether a declaration will do.
+	while (!stack.empty()) {
+		const auto [id, declared] = stack.back();
+		stack.pop_back();
+		if (id == npos || shared[id] != npos) {
+			continue;
+		}
+		const auto target = schemas.target[id];
+		if (target != npos && (!declared || schemas.kind[definitions.schema[target]] != JsonType::Object)
+			&& std::find(deps.begin(), deps.end(), target) == deps.end()) {
+			deps.push_back(target);
+		}
+		if (schemas.items[id] != npos) {
+			stack.emplace_back(schemas.items[id], true);
+		}
+		for (auto prop : schemas.properties[id]) {
+			stack.emplace_back(properties.schema[prop], false);
+		}
+	}
+	return deps;
+}
+
+// Strongly connected components of References, in Tarjan's order, which puts every component after those it
+// references; iterative, since a chain of definitions can be arbitrarily long. Within a component, a depth-first
+// post-order over _Dependencies, where a dependency back into the current path closes a cycle.
+std::vector<DefinitionId> CompiledSpec::DefinitionOrder(std::vector<DefinitionId>* cycle) const {
+	struct Frame {
+		DefinitionId def;
+		std::vector<DefinitionId> refs;
+		size_t next = 0;
+	};
+	std::vector<DefinitionId> order;
+	order.reserve(definitions.size());
+
+	enum : uint8_t { Unvisited, Open, Done };
+	std::vector<uint8_t> state(definitions.size(), Unvisited);
+	std::vector<uint32_t> component_of(definitions.size(), npos);
+	const auto order_component = [&](std::vector<DefinitionId>& members, uint32_t component) {
+		std::sort(members.begin(), members.end());
+		std::vector<Frame> path;
+		for (auto root : members) {
+			if (state[root] != Unvisited) {
+				continue;
+			}
+			state[root] = Open;
+			path.push_back(Frame{root, _Dependencies(root)});
+			while (!path.empty()) {
+				auto& frame = path.back();
+				if (frame.next == frame.refs.size()) {
+					state[frame.def] = Done;
+					order.push_back(frame.def);
+					path.pop_back();
+					continue;
+				}
+				const auto ref = frame.refs[frame.next++];
+				if (component_of[ref] != component) {
+					continue; // Already ordered.
+				}
+				if (state[ref] == Unvisited) {
+					state[ref] = Open;
+					path.push_back(Frame{ref, _Dependencies(ref)});
+				} else if (state[ref] == Open && cycle != nullptr && cycle->empty()) {
+					auto it = std::find_if(path.begin(), path.end(), [ref](const Frame& f) { return f.def == ref; });
+					for (; it != path.end(); ++it) {
+						cycle->push_back(it->def);
+					}
+				}
+			}
+		}
+	};
+
+	std::vector<uint32_t> index(definitions.size(), npos), low(definitions.size());
+	std::vector<DefinitionId> open; // Tarjan's stack.
+	std::vector<uint8_t> on_open(definitions.size(), false);
+	uint32_t next_index = 0, components = 0;
+	std::vector<Frame> stack;
+	const auto visit = [&](DefinitionId def) {
+		index[def] = low[def] = next_index++;
+		open.push_back(def);
+		on_open[def] = true;
+		stack.push_back(Frame{def, References(def)});
+	};
+	for (DefinitionId root = 0; root < definitions.size(); ++root) {
+		if (index[root] != npos) {
+			continue;
+		}
+		visit(root);
+		while (!stack.empty()) {
+			auto& frame = stack.back();
+			if (frame.next != frame.refs.size()) {
+				const auto ref = frame.refs[frame.next++];
+				if (index[ref] == npos) {
+					visit(ref);
+				} else if (on_open[ref]) {
+					low[frame.def] = std::min(low[frame.def], index[ref]);
+				}
+				continue;
+			}
+			const auto def = frame.def;
+			stack.pop_back();
+			if (!stack.empty()) {
+				low[stack.back().def] = std::min(low[stack.back().def], low[def]);
+			}
+			if (low[def] != index[def]) {
+				continue;
+			}
+			std::vector<DefinitionId> members;
+			DefinitionId member;
+			do {
+				member = open.back();
+				open.pop_back();
+				on_open[member] = false;
+				component_of[member] = components;
+				members.push_back(member);
+			} while (member != def);
+			order_component(members, components++);
+		}
+	}
+	return order;
+}
+
+std::string_view CompiledSpec::EnumUnderlyingType(SchemaId id) const {
+	return schemas.enum_[id].count <= 256 ? "uint8_t"sv : "uint16_t"sv;
+}
+
+std::string CompiledSpec::NestedTypeName(std::string_view name) {
+	return sanitize(name) + '_';
+}
+
+// Declares the structs that CppType(id, name) refers to.
+void CompiledSpec::_PrintNestedTypes(std::ostream& out, SchemaId id, std::string_view name, std::string& indent) const {
+	if (id == npos) {
+		return;
+	}
+	if (schemas.kind[id] == JsonType::Array) {
+		_PrintNestedTypes(out, schemas.items[id], name, indent);
+	} else if (shared[id] != npos) {
+		out << indent << "using " << name << " = shared_types::" << strings[shared_types.name[shared[id]]] << ";\n";
+	} else {
+		_PrintType(out, id, name, indent);
+	}
+}
+
+// Declares the struct or enum class of an object or enum schema.
+void CompiledSpec::_PrintType(std::ostream& out, SchemaId id, std::string_view name, std::string& indent) const {
+	if (IsEnum(id)) {
+		out << indent << "enum class " << name << " : " << EnumUnderlyingType(id) << " {\n";
+		for (const auto& enumerator : EnumeratorNames(id)) {
+			out << indent << '\t' << enumerator << ",\n";
+		}
+		out << indent << "};\n";
+	} else if (schemas.kind[id] == JsonType::Object) {
+		out << indent << "struct " << name << " {\n";
+		indent.push_back('\t');
+		for (auto prop : schemas.properties[id]) {
+			const auto propname = strings[properties.name[prop]];
+			const auto propschema = properties.schema[prop];
+			const auto nested = NestedTypeName(propname);
+			write_multiline_comment(out, strings[schemas.description[propschema]], indent);
+			_PrintNestedTypes(out, propschema, nested, indent);
+			out << indent << CppType(propschema, nested) << ' ' << sanitize(propname) << ";\n";
+		}
+		if (UsesAllocator(id)) {
+			_PrintAllocatorConstructors(out, id, name, indent);
+		}
+		indent.pop_back();
+		out << indent << "};\n";
+	}
+}
+
+// Makes a struct allocator-aware in the sense of std::uses_allocator, so std::pmr containers of it pass their
+// memory resource down to every member: an allocator_type, and constructors taking an allocator last.
+void CompiledSpec::_PrintAllocatorConstructors(std::ostream& out, SchemaId id, std::string_view name, const std::string& indent) const {
+	const auto initializers = [&](std::string_view from, bool move) {
+		std::string list;
+		for (auto prop : schemas.properties[id]) {
+			const auto member = sanitize(strings[properties.name[prop]]);
+			const bool aware = UsesAllocator(properties.schema[prop]);
+			if (from.empty() && !aware) {
+				continue;
+			}
+			list += list.empty() ? "\n" + indent + "\t: " : "\n" + indent + "\t, ";
+			list += member + '(';
+			if (!from.empty()) {
+				list += move ? "std::move(" + std::string(from) + '.' + member + ')' : std::string(from) + '.' + member;
+				list += aware ? ", " : "";
+			}
+			list += aware ? "alloc)" : ")";
+		}
+		return list;
+	};
+	out << '\n'
+		<< indent << "using allocator_type = std::pmr::polymorphic_allocator<>;\n"
+		<< indent << name << "() = default;\n"
+		<< indent << name << "(const " << name << "&) = default;\n"
+		<< indent << name << '(' << name << "&&) = default;\n"
+		<< indent << name << "& operator=(const " << name << "&) = default;\n"
+		<< indent << name << "& operator=(" << name << "&&) = default;\n"
+		<< indent << "explicit " << name << "(const allocator_type& alloc)" << initializers("", false) << " {}\n"
+		<< indent << name << "(const " << name << "& other, const allocator_type& alloc)" << initializers("other", false) << " {}\n"
+		<< indent << name << '(' << name << "&& other, const allocator_type& alloc)" << initializers("other", true) << " {}\n";
+}
+
+void CompiledSpec::PrintSharedTypes(std::ostream& out) const {
+	if (shared_types.size() == 0) {
+		return;
+	}
+	out << "namespace shared_types {\n"
+		<< '\n';
+	std::string indent;
+	for (size_t i = 0; i < shared_types.size(); ++i) {
+		_PrintType(out, shared_types.schema[i], strings[shared_types.name[i]], indent);
+		out << '\n';
+	}
+	out << "} // namespace shared_types\n"
+		<< '\n';
+}
+
+JsonType CompiledSpec::PrintSchema(std::ostream& out, SchemaId id, std::string_view name_, std::string& indent) const {
+	std::string name = sanitize(name_);
+	write_multiline_comment(out, strings[schemas.description[id]], indent);
+	if (schemas.kind[id] == JsonType::Object || IsEnum(id)) {
+		_PrintNestedTypes(out, id, name, indent);
+	} else {
+		const auto nested = NestedTypeName(name_);
+		_PrintNestedTypes(out, id, nested, indent);
+		out << indent << "using " << name << " = " << CppType(id, nested) << ";\n";
+	}
+	return schemas.kind[id];
+}
+
+} // namespace openapi
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+std::string matcher_name(openapi::SchemaId id); // Defined in validator.cpp.
+
+namespace {
+
+// Decoders for the leaf types JsonTypeToCppType can produce.
+constexpr auto primitive_decoders = R"(template <typename Traits, typename Allocator>
+simdjson::error_code from_json(simdjson::ondemand::value v, std::basic_string<char, Traits, Allocator>& out) {
+	std::string_view sv;
+	auto err = v.get_string().get(sv);
+	if (!err) {
+		out.assign(sv);
+	}
+	return err;
+}
+
+inline simdjson::error_code from_json(simdjson::ondemand::value v, bool& out) {
+	return v.get_bool().get(out);
+}
+
+inline simdjson::error_code from_json(simdjson::ondemand::value v, int64_t& out) {
+	return v.get_int64().get(out);
+}
+
+inline simdjson::error_code from_json(simdjson::ondemand::value v, int32_t& out) {
+	int64_t i = 0;
+	auto err = v.get_int64().get(i);
+	if (!err && (i < INT32_MIN || i > INT32_MAX)) {
+		return simdjson::NUMBER_OUT_OF_RANGE;
+	}
+	out = static_cast<int32_t>(i);
+	return err;
+}
+
+inline simdjson::error_code from_json(simdjson::ondemand::value v, double& out) {
+	return v.get_double().get(out);
+}
+
+inline simdjson::error_code from_json(simdjson::ondemand::value v, float& out) {
+	double d = 0;
+	auto err = v.get_double().get(d);
+	out = static_cast<float>(d);
+	return err;
+}
+
+// Untyped schemas have no C++ representation; the value is skipped.
+inline simdjson::error_code from_json(simdjson::ondemand::value, void*&) {
+	return simdjson::SUCCESS;
+}
+
+)"sv;
+
+// Decoder for std::vector of anything decodable. Its element call is only resolved by argument-dependent lookup
+// past this point, which misses the global overloads for types in namespace shared_types, so every overload
+// must be declared before it.
+// Elements are constructed by the vector, so with std::pmr types they use its memory resource.
+constexpr auto vector_decoder = R"(template <typename T, typename Allocator>
+simdjson::error_code from_json(simdjson::ondemand::value v, std::vector<T, Allocator>& out) {
+	simdjson::ondemand::array arr;
+	SIMDJSON_TRY(v.get_array().get(arr));
+	out.clear();
+	for (auto element : arr) {
+		simdjson::ondemand::value ev;
+		SIMDJSON_TRY(element.get(ev));
+		SIMDJSON_TRY(from_json(ev, out.emplace_back()));
+	}
+	return simdjson::SUCCESS;
+}
+
+)"sv;
+
+// Checks a decoded value against the string constraints in its schema, including those on array items and on
+// referenced aliases. Object members are not visited: their own from_json has checked them.
+void WriteValueChecks(std::ostream& out, const openapi::CompiledSpec& spec, openapi::SchemaId id, const std::string& expr, std::string& indent, int depth) {
+	if (id == openapi::npos || depth > 8) {
+		return;
+	}
+	switch (spec.schemas.kind[id]) {
+	case openapi::JsonType::Reference: {
+		const auto def = spec.schemas.target[id];
+		if (def != openapi::npos && spec.schemas.kind[spec.definitions.schema[def]] != openapi::JsonType::Object) {
+			WriteValueChecks(out, spec, spec.definitions.schema[def], expr, indent, depth + 1);
+		}
+		break;
+	}
+	case openapi::JsonType::Array: {
+		// Only emit the loop if some element check ends up inside it.
+		const auto element = "e" + std::to_string(depth);
+		std::ostringstream body;
+		indent.push_back('\t');
+		WriteValueChecks(body, spec, spec.schemas.items[id], element, indent, depth + 1);
+		indent.pop_back();
+		if (!body.str().empty()) {
+			out << indent << "for (const auto& " << element << " : " << expr << ") {\n"
+				<< body.str()
+				<< indent << "}\n";
+		}
+		break;
+	}
+	case openapi::JsonType::Primitive:
+		if (spec.IsConstrainedString(id)) {
+			out << indent << "if (!" << matcher_name(id) << '(' << expr << ")) {\n"
+				<< indent << "\treturn simdjson::INCORRECT_TYPE;\n"
+				<< indent << "}\n";
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void WriteStructDecoder(std::ostream& out, const openapi::CompiledSpec& spec, openapi::SchemaId id, const std::string& qualified) {
+	// Field dispatch is decided here, at generation time: switch on key length, then compare against the few
+	// property names of that length.
+	std::map<size_t, std::vector<uint32_t>> by_length;
+	for (auto prop : spec.schemas.properties[id]) {
+		by_length[spec.strings[spec.properties.name[prop]].size()].push_back(prop);
+	}
+
+	// Required members each get a bit; they are all present if the mask is full once the object has been read.
+	std::map<uint32_t, size_t> required_bit;
+	for (auto i : spec.schemas.required[id]) {
+		for (auto prop : spec.schemas.properties[id]) {
+			if (spec.properties.name[prop] == spec.string_lists[i] && !required_bit.count(prop)) {
+				const size_t bit = required_bit.size();
+				required_bit.emplace(prop, bit);
+			}
+		}
+	}
+	const size_t words = (required_bit.size() + 63) / 64;
+
+	out << "inline simdjson::error_code from_json(simdjson::ondemand::value v, " << qualified << "& out) {\n"
+		<< "\tsimdjson::ondemand::object obj;\n"
+		<< "\tSIMDJSON_TRY(v.get_object().get(obj));\n";
+	if (by_length.empty()) {
+		out << "\t(void)out;\n"
+			<< "\treturn simdjson::SUCCESS;\n"
+			<< "}\n\n";
+		return;
+	}
+	if (words != 0) {
+		out << "\tuint64_t seen[" << words << "] = {};\n";
+	}
+	out << "\tfor (auto field : obj) {\n"
+		<< "\t\tstd::string_view key;\n"
+		<< "\t\tSIMDJSON_TRY(field.unescaped_key().get(key));\n"
+		<< "\t\tsimdjson::ondemand::value fv;\n"
+		<< "\t\tSIMDJSON_TRY(field.value().get(fv));\n"
+		<< "\t\tbool is_null = false;\n"
+		<< "\t\tif (fv.is_null().get(is_null) == simdjson::SUCCESS && is_null) {\n"
+		<< "\t\t\tcontinue;\n"
+		<< "\t\t}\n"
+		<< "\t\tswitch (key.size()) {\n";
+	for (const auto& [len, props] : by_length) {
+		out << "\t\tcase " << len << ":\n";
+		for (auto prop : props) {
+			const auto name = spec.strings[spec.properties.name[prop]];
+			const auto member = "out." + sanitize(name);
+			out << "\t\t\tif (key == \"" << cpp_escape(name) << "\"sv) {\n"
+				<< "\t\t\t\tSIMDJSON_TRY(from_json(fv, " << member << "));\n";
+			std::string indent = "\t\t\t\t";
+			WriteValueChecks(out, spec, spec.properties.schema[prop], member, indent, 0);
+			if (auto it = required_bit.find(prop); it != required_bit.end()) {
+				out << "\t\t\t\tseen[" << it->second / 64 << "] |= uint64_t(1) << " << it->second % 64 << ";\n";
+			}
+			out << "\t\t\t\tcontinue;\n"
+				<< "\t\t\t}\n";
+		}
+		out << "\t\t\tbreak;\n";
+	}
+	out << "\t\tdefault: break;\n"
+		<< "\t\t}\n"
+		<< "\t\t// Unknown members are skipped by the iterator.\n"
+		<< "\t}\n";
+	for (size_t w = 0; w < words; ++w) {
+		const size_t bits = std::min<size_t>(required_bit.size() - w * 64, 64);
+		const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+		out << "\tif (seen[" << w << "] != 0x" << std::hex << mask << std::dec << "u) {\n"
+			<< "\t\treturn simdjson::NO_SUCH_FIELD;\n"
+			<< "\t}\n";
+	}
+	out << "\treturn simdjson::SUCCESS;\n"
+		<< "}\n\n";
+}
+
+} // namespace
+
+// Writes simdjson On-Demand decoders, from_json(value, T&), for every struct in the definitions file.
+// Values are decoded straight from the input into the structs, without building a DOM, and validated as they are:
+// a missing required member fails with NO_SUCH_FIELD, a string outside its pattern or enum with INCORRECT_TYPE.
+void deserializers(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	const auto defs_header = input.stem().string() + "_defs.hpp";
+	auto out = OutputFile(output / (input.stem().string() + "_from_json.hpp"));
+	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+		<< "#pragma once\n"
+		<< "#include <cstdint>\n"
+		<< "#include <string>\n"
+		<< "#include <string_view>\n"
+		<< "#include <vector>\n"
+		<< '\n'
+		<< "#include <simdjson.h>\n"
+		<< '\n'
+		<< "#include \"" << defs_header << "\"\n"
+		<< "#include \"" << input.stem().string() << "_validate.hpp\"\n"
+		<< '\n'
+		<< primitive_decoders;
+
+	// Enums decode through the constexpr tables in the definitions header.
+	spec.ForEachEnum([&out](openapi::SchemaId, const std::string& qualified) {
+		out << "inline simdjson::error_code from_json(simdjson::ondemand::value v, " << qualified << "& out) {\n"
+			<< "\tstd::string_view sv;\n"
+			<< "\tSIMDJSON_TRY(v.get_string().get(sv));\n"
+			<< "\treturn enum_from_string(sv, out) ? simdjson::SUCCESS : simdjson::INCORRECT_TYPE;\n"
+			<< "}\n\n";
+	});
+
+	std::vector<std::pair<openapi::SchemaId, std::string>> structs;
+	spec.ForEachStruct([&structs](openapi::SchemaId id, const std::string& qualified) {
+		structs.emplace_back(id, qualified);
+	});
+
+	// Declared up front, since structs may contain each other in any order, and ahead of the vector decoder.
+	for (const auto& [id, qualified] : structs) {
+		out << "inline simdjson::error_code from_json(simdjson::ondemand::value v, " << qualified << "& out);\n";
+	}
+	out << '\n'
+		<< vector_decoder;
+	render_sharded(out, structs.size(), [&](std::ostream& out, size_t i) {
+		WriteStructDecoder(out, spec, structs[i].first, structs[i].second);
+	});
+
+	out << "// Decodes a whole document, e.g. a request body, into out.\n"
+		<< "template <typename T>\n"
+		<< "simdjson::error_code from_json(simdjson::ondemand::parser& parser, simdjson::padded_string_view json, T& out) {\n"
+		<< "\tsimdjson::ondemand::document doc;\n"
+		<< "\tSIMDJSON_TRY(parser.iterate(json).get(doc));\n"
+		<< "\tsimdjson::ondemand::value v;\n"
+		<< "\tSIMDJSON_TRY(doc.get_value().get(v));\n"
+		<< "\treturn from_json(v, out);\n"
+		<< "}\n";
+}
@@ -1,71 +1,475 @@
+#include <algorithm>
+#include <cctype>
 #include <charconv>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <string_view>
+#include <thread>
 #include <vector>
 
+#include "compiled_spec.hpp"
+#include "manifest.hpp"
 #include "openapi2.hpp"
+#include "output.hpp"
+#include "profile.hpp"
 #include "util.hpp"
+#include "yaml.hpp"
 
 namespace fs = std::filesystem;
 using namespace std::literals;
 
 // Forward-declared backends
-void beast(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file);
-void beauty(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file);
-void nghttp2(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file);
+void beast(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void beauty(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void nghttp2(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void validators(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void deserializers(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void serializers(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+void views(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+
+void definitions_prologue(std::ostream& out, const fs::path& input, const openapi::CompiledSpec& spec) {
+	out << "// Automatically generated from " << input.stem() << ". Do not modify this file.\n"
+		<< "#pragma once\n"
+		<< "#include <array>\n"
+		<< "#include <cstdint>\n";
+	if (spec.pmr) {
+		out << "#include <memory_resource>\n";
+	}
+	out << "#include <string>\n"
+		<< "#include <string_view>\n"
+		<< "#include <vector>\n"
+		<< "using namespace std::literals;\n"
+		<< '\n';
+}
+
+// Declares the definitions referenced ahead of their declaration, which only happens within a reference cycle.
+void forward_declarations(std::ostream& out, const openapi::CompiledSpec& spec, const std::vector<openapi::DefinitionId>& order) {
+	std::vector<uint8_t> declared(spec.definitions.size(), false), needed(spec.definitions.size(), false);
+	for (auto def : order) {
+		for (auto ref : spec.References(def)) {
+			needed[ref] = needed[ref] || !declared[ref];
+		}
+		declared[def] = true;
+	}
+	for (auto def : order) {
+		if (!needed[def]) {
+			continue;
+		}
+		const auto id = spec.definitions.schema[def];
+		const auto name = spec.strings[spec.definitions.type_name[def]];
+		if (spec.IsEnum(id)) {
+			out << "enum class " << name << " : " << spec.EnumUnderlyingType(id) << ";\n";
+		} else if (spec.schemas.kind[id] == openapi::JsonType::Object) {
+			out << "struct " << name << ";\n";
+		}
+	}
+	out << '\n';
+}
+
+// Write the struct definitions file, same for every backend.
+// Definitions are declared after the ones they contain, since a member needs a complete type.
+void definitions(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	fs::path definitions_file = output / (input.stem().string() + "_defs.hpp");
+	auto out = OutputFile(definitions_file);
+	definitions_prologue(out, input, spec);
+	spec.PrintSharedTypes(out);
+	const auto order = spec.DefinitionOrder();
+	forward_declarations(out, spec, order);
+	render_sharded(out, order.size(), [&spec, &order](std::ostream& out, size_t i) {
+		std::string indent = "";
+		indent.reserve(3);
+		const auto def = order[i];
+		spec.PrintSchema(out, spec.definitions.schema[def], spec.strings[spec.definitions.type_name[def]], indent);
+	});
+	out << '\n';
+	spec.ForEachEnum([&spec, &out](openapi::SchemaId id, const std::string& qualified) {
+		spec.PrintEnumConversions(out, id, qualified);
+	});
+	out << '\n';
+}
+
+// Like definitions, but with one header per definition, so a change to one type only rebuilds what includes it.
+// Each header includes the headers of the definitions it references, so it can be used on its own. Within a
+// reference cycle, <stem>_fwd.hpp declares the definitions that come later, and their headers are included after
+// the declaration. <stem>_defs.hpp still includes everything, in dependency order.
+void split_definitions(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	const auto stem = input.stem().string();
+	const auto header = [&](openapi::DefinitionId def) {
+		return stem + "_def_" + std::string(spec.strings[spec.definitions.type_name[def]]) + ".hpp";
+	};
+	const auto fwd_header = stem + "_fwd.hpp", shared_header = stem + "_shared_types.hpp";
+	const auto order = spec.DefinitionOrder();
+
+	auto fwd = OutputFile(output / fwd_header);
+	fwd << "// Automatically generated from " << input.stem() << ". Do not modify this file.\n"
+		<< "#pragma once\n"
+		<< "#include <cstdint>\n"
+		<< '\n';
+	forward_declarations(fwd, spec, order);
+	fwd.Commit();
+
+	if (spec.shared_types.size() != 0) {
+		auto shared = OutputFile(output / shared_header);
+		definitions_prologue(shared, input, spec);
+		spec.PrintSharedTypes(shared);
+		spec.ForEachEnumOf(openapi::npos, [&spec, &shared](openapi::SchemaId id, const std::string& qualified) {
+			spec.PrintEnumConversions(shared, id, qualified);
+		});
+	}
+
+	std::vector<uint8_t> written(spec.definitions.size(), false);
+	for (auto def : order) {
+		auto out = OutputFile(output / header(def));
+		definitions_prologue(out, input, spec);
+		const auto refs = spec.References(def);
+		if (std::any_of(refs.begin(), refs.end(), [&written](auto ref) { return !written[ref]; })) {
+			out << "#include \"" << fwd_header << "\"\n";
+		}
+		if (spec.UsesSharedTypes(def)) {
+			out << "#include \"" << shared_header << "\"\n";
+		}
+		for (auto ref : refs) {
+			if (written[ref]) {
+				out << "#include \"" << header(ref) << "\"\n";
+			}
+		}
+		out << '\n';
+		std::string indent;
+		spec.PrintSchema(out, spec.definitions.schema[def], spec.strings[spec.definitions.type_name[def]], indent);
+		out << '\n';
+		spec.ForEachEnumOf(def, [&spec, &out](openapi::SchemaId id, const std::string& qualified) {
+			spec.PrintEnumConversions(out, id, qualified);
+		});
+		// The rest of the cycle, now that this definition is complete, so the header can still be used alone.
+		for (auto ref : refs) {
+			if (!written[ref]) {
+				out << "#include \"" << header(ref) << "\"\n";
+			}
+		}
+		written[def] = true;
+	}
+
+	auto all = OutputFile(output / (stem + "_defs.hpp"));
+	all << "// Automatically generated from " << input.stem() << ". Do not modify this file.\n"
+		<< "#pragma once\n"
+		<< "#include \"" << fwd_header << "\"\n";
+	if (spec.shared_types.size() != 0) {
+		all << "#include \"" << shared_header << "\"\n";
+	}
+	for (auto def : order) {
+		all << "#include \"" << header(def) << "\"\n";
+	}
+}
+
+// Options that change what is generated, so a manifest written under different ones is not reused.
+std::string generator_options(bool split, bool pmr, const openapi::Selection& selection) {
+	std::string options = "backend=beast";
+	if (split) {
+		options += ";split-definitions";
+	}
+	if (pmr) {
+		options += ";pmr";
+	}
+	if (!selection.empty()) {
+		options += ";select:" + selection.ToString();
+	}
+	return options;
+}
+
+// Maps the spec into memory, or reads it into owned where mapping is unavailable. json views whichever worked.
+bool read_spec(const fs::path& input, openapi::__detail::PaddedMapping& mapping, simdjson::padded_string& owned,
+	simdjson::padded_string_view& json) {
+	if (mapping.Map(input.string())) {
+		json = mapping.view();
+	} else if (simdjson::padded_string::load(input.string()).get(owned) == simdjson::SUCCESS) {
+		json = owned;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+// Specs named *.yaml or *.yml are read as YAML, anything else as JSON.
+bool is_yaml(const fs::path& input) {
+	auto extension = input.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+	return extension == ".yaml" || extension == ".yml";
+}
+
+// Hashes the parts of the spec for --incremental.
+bool hash_spec(const fs::path& input, std::string_view options, Manifest& manifest) {
+	openapi::__detail::PaddedMapping mapping;
+	simdjson::padded_string owned;
+	simdjson::padded_string_view json;
+	if (!read_spec(input, mapping, owned, json)) {
+		return false;
+	}
+	manifest.Set(Manifest::Section::Global, "$generator", fnv1a(options));
+	if (is_yaml(input)) {
+		simdjson::dom::document doc;
+		return openapi::ParseYaml(std::string_view(json.data(), json.size()), doc) && manifest.HashDocument(doc.root());
+	}
+	return manifest.HashDocument(json);
+}
 
 int main(int argc, char* argv[]) {
 	if (argc < 3) {
-		std::cerr << "Two args required, path to JSON file, and output file path." << std::endl;
+		std::cerr << "Two args required, path to JSON (or YAML) file, and output file path." << std::endl;
+		std::cerr << "Options:\n"
+				  << "  -j, --jobs N    Generate with N threads (default 1, 0 for one per core).\n"
+				  << "  --incremental   Only regenerate files whose part of the spec changed since the last run.\n"
+				  << "  --cache DIR     Keep the parsed spec in DIR, keyed by a hash of its content, and reuse it on later runs.\n"
+				  << "  --tag NAME      Only generate the operations tagged NAME, and the definitions they reach through $ref.\n"
+				  << "  --operation ID  Only generate the operation with operationId ID, and the definitions it reaches.\n"
+				  << "                  Both may be repeated; an operation is kept if any of them selects it.\n"
+				  << "                  Each must select at least one operation.\n"
+				  << "  --pmr           Use std::pmr strings and vectors in the generated types, with allocator-aware constructors.\n"
+				  << "  --split-definitions\n"
+				  << "                  Write one header per definition, plus <stem>_fwd.hpp and an aggregate <stem>_defs.hpp.\n"
+				  << "  --profile FILE  Write the time, output size and peak memory of each phase to FILE as JSON ('-' for stdout).\n"
+				  << "                  Phases run one after another, whatever --jobs says.\n";
 		return 1;
 	}
 
+	bool incremental = false, split = false, pmr = false;
+	std::string_view profile_file, cache_dir;
+	openapi::Selection selection;
+	for (int i = 3; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "--incremental") {
+			incremental = true;
+		} else if (arg == "--pmr") {
+			pmr = true;
+		} else if (arg == "--split-definitions") {
+			split = true;
+		} else if (arg == "--tag" && i + 1 < argc) {
+			selection.tags.emplace_back(argv[++i]);
+		} else if (arg == "--operation" && i + 1 < argc) {
+			selection.operation_ids.emplace_back(argv[++i]);
+		} else if (arg == "--cache" && i + 1 < argc) {
+			cache_dir = argv[++i];
+		} else if (arg == "--profile" && i + 1 < argc) {
+			profile_file = argv[++i];
+		} else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+			std::string_view value = argv[++i];
+			unsigned jobs = 1;
+			if (std::from_chars(value.data(), value.data() + value.size(), jobs).ec != std::errc()) {
+				std::cerr << "Invalid job count " << value << std::endl;
+				return 1;
+			}
+			set_parallelism(jobs == 0 ? std::thread::hardware_concurrency() : jobs);
+		} else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	// With the profile on stdout, progress goes to stderr so that stdout is only JSON.
+	std::ostream& status = profile_file == "-" ? std::cerr : std::cout;
+
 	fs::path input(argv[1]);
 	if (!fs::exists(input) || !fs::is_regular_file(input)) {
 		std::cerr << "File at " << input << " does not exist." << std::endl;
 		return 1;
 	} else {
-		std::cout << "Reading from " << input.string() << std::endl;
+		status << "Reading from " << input.string() << std::endl;
 	}
 	fs::path output(argv[2]);
 	if (!fs::exists(output) || !fs::is_directory(output)) {
 		std::cerr << "Output path " << output << " does not exist or is not a directory." << std::endl;
 		return 1;
 	} else {
-		std::cout << "Writing to " << output.string() << std::endl;
+		status << "Writing to " << output.string() << std::endl;
 	}
 
-	openapi::OpenAPI2 file;
-	if (!file.Load(argv[1])) {
-		std::cerr << "Failed to load " << argv[1] << std::endl;
-		return -1;
+	Profile profile;
+	const bool profiling = !profile_file.empty();
+	const auto run = [&](std::string_view phase, const auto& body) {
+		if (profiling) {
+			profile.Measure(phase, body);
+		} else {
+			body();
+		}
+	};
+
+	// With --incremental, compare the hashes of the spec's parts against the previous run to see which outputs are stale.
+	const fs::path manifest_file = output / (input.stem().string() + ".manifest");
+	Manifest previous, current;
+	bool write_definitions = true, write_backend = true;
+	if (incremental) {
+		previous.Load(manifest_file);
+		if (!hash_spec(input, generator_options(split, pmr, selection), current)) {
+			std::cerr << "Failed to load " << argv[1] << std::endl;
+			return -1;
+		}
+		const auto& files = previous.entries(Manifest::Section::File);
+		const bool outputs_present = !files.empty() && std::all_of(files.begin(), files.end(), [&output](const auto& file) {
+			return fs::exists(output / file.first);
+		});
+		if (outputs_present) {
+			const auto& old_globals = previous.entries(Manifest::Section::Global);
+			const auto& new_globals = current.entries(Manifest::Section::Global);
+			const bool same_generator = old_globals.contains("$generator") && old_globals.at("$generator") == new_globals.at("$generator");
+			write_definitions = !(same_generator && previous.SameSection(current, Manifest::Section::Definition));
+			write_backend = !(previous.SameSection(current, Manifest::Section::Global) && previous.SameSection(current, Manifest::Section::Path));
+			// Which definitions a selection reaches depends on its operations, so they are stale whenever those are.
+			write_definitions = write_definitions || (!selection.empty() && write_backend);
+		}
+		if (!write_definitions) {
+			status << "Definitions unchanged" << std::endl;
+		}
+		if (!write_backend) {
+			status << "Paths unchanged" << std::endl;
+		}
 	}
 
-	// nghttp2(input, output, file);
-	// beauty(input, output, file);
-	beast(input, output, file);
+	if (write_definitions || write_backend) {
+		openapi::__detail::PaddedMapping mapping;
+		simdjson::padded_string owned;
+		simdjson::padded_string_view json;
+		openapi::OpenAPI2 file;
+		bool loaded = false;
+		run("load", [&] { loaded = read_spec(input, mapping, owned, json); });
 
-	// Write the struct definitions file, same for every backend.
-	fs::path definitions_file = output / (input.stem().string() + "_defs.hpp");
-	auto out = std::ofstream(definitions_file);
-	out << "// Automatically generated from " << input.stem() << ". Do not modify this file.\n"
-		<< "#pragma once\n"
-		<< "#include <array>\n"
-		<< "#include <string>\n"
-		<< "#include <string_view>\n"
-		<< "#include <vector>\n"
-		<< "using namespace std::literals;\n"
-		<< std::endl;
-	std::string indent = "";
-	indent.reserve(3);
-	for (const auto& [defstr, def] : file.definitions()) {
-		def.Print(out, defstr, indent);
+		// Backends read the flattened tables rather than walking the DOM themselves.
+		// With --cache, those tables come from a previous run over the same bytes if there was one.
+		openapi::CompiledSpec spec;
+		bool cached = false;
+		uint64_t cache_key = 0;
+		fs::path cache_file;
+		if (loaded && !cache_dir.empty()) {
+			run("cache", [&] {
+				// The tables only hold what the selection kept, so a selection makes for a different key.
+				cache_key = fnv1a(selection.ToString(), fnv1a(std::string_view(json.data(), json.size())));
+				char name[32];
+				std::snprintf(name, sizeof(name), "%016llx.spec", static_cast<unsigned long long>(cache_key));
+				cache_file = fs::path(cache_dir) / name;
+				cached = spec.LoadCache(cache_file, cache_key);
+			});
+		}
+		if (loaded && !cached) {
+			if (is_yaml(input)) {
+				std::string error;
+				run("parse", [&] { loaded = file.LoadYaml(std::string_view(json.data(), json.size()), &error); });
+				if (!loaded) {
+					std::cerr << input.string() << ": " << error << std::endl;
+				}
+			} else {
+				run("parse", [&] { loaded = file.Load(json); });
+			}
+		}
+		// The DOM copies everything it needs out of the input, so it can be released once parsed.
+		mapping.Unmap();
+		owned = simdjson::padded_string();
+		if (!loaded) {
+			std::cerr << "Failed to load " << argv[1] << std::endl;
+			return -1;
+		}
+		if (profiling) {
+			profile.Set("input_bytes", json.size());
+			profile.Set("cache_hit", cached);
+		}
+		if (profiling && !cached) {
+			const auto stats = file.Stats();
+			profile.Set("tape_bytes", stats.tape_bytes);
+			profile.Set("tape_capacity_bytes", stats.tape_capacity);
+			profile.Set("string_buffer_bytes", stats.string_bytes);
+			profile.Set("string_buffer_capacity_bytes", stats.string_capacity);
+			profile.Set("json_objects", stats.objects);
+			profile.Set("json_arrays", stats.arrays);
+			profile.Set("json_strings", stats.strings);
+			profile.Set("json_numbers", stats.numbers);
+			profile.Set("json_literals", stats.literals);
+		}
+
+		if (!cached) {
+			run("compile", [&] { spec.Compile(file, selection); });
+			std::error_code ec;
+			if (!cache_file.empty() && (fs::create_directories(cache_dir, ec), !spec.SaveCache(cache_file, cache_key))) {
+				std::cerr << "Failed to write " << cache_file.string() << std::endl;
+			}
+		}
+		spec.pmr = pmr;
+
+		// A selector that matches nothing is most likely a typo; generating an empty API would hide it.
+		const auto unmatched = spec.UnmatchedSelectors(selection);
+		for (const auto& selector : unmatched) {
+			std::cerr << input.string() << ": " << selector << " matches no operation" << std::endl;
+		}
+		if (!unmatched.empty()) {
+			return -1;
+		}
+
+		std::vector<openapi::DefinitionId> cycle;
+		spec.DefinitionOrder(&cycle);
+		if (!cycle.empty()) {
+			std::cerr << input.string() << ": ";
+			for (auto def : cycle) {
+				std::cerr << spec.strings[spec.definitions.name[def]] << " -> ";
+			}
+			std::cerr << spec.strings[spec.definitions.name[cycle.front()]]
+				<< ": a definition cannot contain itself by value; refer to it through an array" << std::endl;
+			return -1;
+		}
+
+		// The definitions file does not depend on the backend, so it can be written alongside it.
+		auto defs = std::async(parallelism() > 1 && !profiling ? std::launch::async : std::launch::deferred, [&] {
+			if (write_definitions) {
+				run("definitions", [&] { (split ? split_definitions : definitions)(input, output, spec); });
+			}
+			// Besides the schema matchers, the validators header holds the parameter checks the server calls,
+			// which depend on the paths.
+			run("validators", [&] { validators(input, output, spec); });
+			if (write_definitions) {
+				run("deserializers", [&] { deserializers(input, output, spec); });
+				run("serializers", [&] { serializers(input, output, spec); });
+				run("views", [&] { views(input, output, spec); });
+			}
+		});
+		if (profiling) {
+			defs.wait();
+		}
+
+		if (write_backend) {
+			// run("nghttp2", [&] { nghttp2(input, output, spec); });
+			// run("beauty", [&] { beauty(input, output, spec); });
+			run("beast", [&] { beast(input, output, spec); });
+		}
+
+		defs.get();
+	}
+
+	if (incremental) {
+		// Files that were skipped this time carry over from the previous run.
+		for (const auto& [name, hash] : previous.entries(Manifest::Section::File)) {
+			current.Set(Manifest::Section::File, name, hash);
+		}
+		for (const auto& record : committed_outputs()) {
+			current.Set(Manifest::Section::File, record.path.filename().string(), record.hash);
+		}
+		if (!current.Save(manifest_file)) {
+			std::cerr << "Failed to write " << manifest_file.string() << std::endl;
+			return -1;
+		}
+	}
+
+	if (profiling) {
+		if (profile_file == "-") {
+			profile.WriteJson(std::cout);
+		} else {
+			std::ofstream out{std::string(profile_file)};
+			profile.WriteJson(out);
+			if (!out) {
+				std::cerr << "Failed to write " << profile_file << std::endl;
+				return -1;
+			}
+		}
 	}
-	out << std::endl;
 
 	return 0;
 }
@@ -0,0 +1,102 @@
+#include <charconv>
+#include <fstream>
+
+#include "manifest.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The section a top-level member of the spec is recorded in.
+Manifest::Section section_of(std::string_view key) {
+	return key == "paths" ? Manifest::Section::Path : key == "definitions" ? Manifest::Section::Definition : Manifest::Section::Global;
+}
+
+} // namespace
+
+Manifest::Entries& Manifest::_Entries(Section section) {
+	switch (section) {
+	case Section::Path:       return _paths;
+	case Section::Definition: return _definitions;
+	case Section::Global:     return _globals;
+	default: break;
+	}
+	return _files;
+}
+
+void Manifest::Set(Section section, std::string_view key, uint64_t hash) {
+	_Entries(section).insert_or_assign(std::string(key), hash);
+}
+
+bool Manifest::empty() const noexcept {
+	return _paths.empty() && _definitions.empty() && _globals.empty() && _files.empty();
+}
+
+bool Manifest::SameSection(const Manifest& other, Section section) const {
+	return entries(section) == other.entries(section);
+}
+
+// One entry per line: section character, hash in hex, then the key up to the end of the line.
+bool Manifest::Load(const fs::path& file) {
+	*this = Manifest();
+	std::ifstream in(file);
+	if (!in) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)) {
+		std::string_view sv = line;
+		if (sv.size() < 4 || sv[1] != '\t') {
+			continue;
+		}
+		const auto section = static_cast<Section>(sv[0]);
+		sv.remove_prefix(2);
+		uint64_t hash = 0;
+		auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), hash, 16);
+		if (ec != std::errc() || ptr == sv.data() + sv.size() || *ptr != '\t') {
+			continue;
+		}
+		sv.remove_prefix(ptr - sv.data() + 1);
+		Set(section, sv, hash);
+	}
+	return true;
+}
+
+bool Manifest::Save(const fs::path& file) const {
+	std::ofstream out(file, std::ios::binary | std::ios::trunc);
+	for (auto section : {Section::Global, Section::Definition, Section::Path, Section::File}) {
+		for (const auto& [key, hash] : entries(section)) {
+			out << static_cast<char>(section) << '\t' << std::hex << hash << std::dec << '\t' << key << '\n';
+		}
+	}
+	return static_cast<bool>(out);
+}
+
+bool Manifest::HashDocument(simdjson::padded_string_view json) {
+	simdjson::ondemand::parser parser;
+	simdjson::ondemand::document doc;
+	simdjson::ondemand::object root;
+	if (parser.iterate(json).get(doc) != simdjson::SUCCESS || doc.get_object().get(root) != simdjson::SUCCESS) {
+		return false;
+	}
+	for (auto member : root) {
+		std::string_view key, raw;
+		if (member.unescaped_key().get(key) != simdjson::SUCCESS || member.value().raw_json().get(raw) != simdjson::SUCCESS) {
+			return false;
+		}
+		Set(section_of(key), key, fnv1a(raw));
+	}
+	return true;
+}
+
+bool Manifest::HashDocument(const simdjson::dom::element& root) {
+	simdjson::dom::object members;
+	if (root.get_object().get(members) != simdjson::SUCCESS) {
+		return false;
+	}
+	for (auto [key, value] : members) {
+		Set(section_of(key), key, fnv1a(simdjson::minify(value)));
+	}
+	return true;
+}
@@ -1,13 +1,16 @@
 #include <filesystem>
 #include <fstream>
 
-#include "openapi2.hpp"
+#include "compiled_spec.hpp"
+#include "output.hpp"
 #include "util.hpp"
 
 namespace fs = std::filesystem;
 using namespace std::literals;
 
-void WriteHeader(std::ostream& out, const openapi::OpenAPI2& file) {
+void router(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec);
+
+void WriteHeader(std::ostream& out, const openapi::CompiledSpec& spec) {
 	out << "#pragma once\n"
 		<< "#include <nghttp2/nghttp2.h>\n"
 		<< "#include <nghttp2/asio_http2.h>\n"
@@ -18,65 +21,73 @@ void WriteHeader(std::ostream& out, const openapi::OpenAPI2& file) {
 		<< '\n'
 		<< "// This file contains function prototypes for each path/requestmethod pair.\n"
 		<< "// Implement the function bodies for each prototype here.\n"
-		<< std::endl;
+		<< '\n';
 
-	for (const auto& [pathstr, path] : file.paths()) {
-		for (const auto& [opstr, op] : path.operations()) {
-			write_multiline_comment(out, op.description());
-			out << "void " << op.operation_id() << "(const Request& req, const Response& res);\n\n";
-		}
-	}
+	const auto& ops = spec.operations;
+	render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+		write_multiline_comment(out, spec.strings[ops.description[op]]);
+		out << "void " << spec.strings[ops.operation_id[op]] << "(const Request& req, const Response& res);\n\n";
+	});
 	out << '\n'
 		<< "// Call this function to get an instance of a server object with all paths laid out.\n"
-		<< "nghttp2::asio_http2::server::http2 add_routes();" << std::endl;
+		<< "nghttp2::asio_http2::server::http2 add_routes();\n";
 }
 
-void WriteImpl(std::ofstream& out, openapi::OpenAPI2& file) {
-	out << "nghttp2::asio_http2::server::http2& add_routes(nghttp2::asio_http2::server::http2& server) {\n";
-	for (const auto& [pathstr, path] : file.paths()) {
-		for (const auto& [opstr, op] : path.operations()) {
-			out << "\t\tif (req.method() == \"" << opstr << "\") {\n"
-				<< "\t\t\treturn " << op.operation_id() << "(req, res);\n"
-				<< "\t\t}\n";
-		}
-	}
-	out << "\treturn server;\n"
+void WriteImpl(std::ostream& out, const openapi::CompiledSpec& spec) {
+	// A single handler dispatches through the generated router instead of comparing every route in turn.
+	out << "nghttp2::asio_http2::server::http2& add_routes(nghttp2::asio_http2::server::http2& server) {\n"
+		<< "\tserver.handle(\"/\", [](const Request& req, const Response& res) {\n"
+		<< "\t\tconst auto match = match_route(method_from_string(req.method()), req.uri().path);\n"
+		<< "\t\tswitch (match.route) {\n";
+	const auto& ops = spec.operations;
+	render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+		const auto name = spec.FunctionName(op);
+		out << "\t\tcase Route::" << name << ": return " << spec.strings[ops.operation_id[op]] << "(req, res);\n";
+	});
+	out << "\t\tcase Route::MethodNotAllowed: res.write_head(405); res.end(); return;\n"
+		<< "\t\tdefault: res.write_head(404); res.end(); return;\n"
+		<< "\t\t}\n"
+		<< "\t});\n"
+		<< "\treturn server;\n"
 		<< "}\n"
-		<< std::endl;
+		<< '\n';
 }
 
-void WriteStub(std::ofstream& out, openapi::OpenAPI2& file) {
-	for (const auto& [pathstr, path] : file.paths()) {
-		for (const auto& [opstr, op] : path.operations()) {
-			out << "void " << op.operation_id() << "(const Request& req, const Response& res) {\n"
-				<< "\t// Request\n";
-			for (const auto& param : op.parameters()) {
-				write_multiline_comment(out, param.description(), "\t");
-				// out << "\t" << JsonTypeToCppType(parameter["type"].get_string()) << ' ' << parameter["name"].get_string() << ";\n";
-			}
-			out << "}\n" << std::endl;
+void WriteStub(std::ostream& out, const openapi::CompiledSpec& spec) {
+	const auto& ops = spec.operations;
+	render_sharded(out, ops.size(), [&](std::ostream& out, size_t op) {
+		out << "void " << spec.strings[ops.operation_id[op]] << "(const Request& req, const Response& res) {\n"
+			<< "\t// Request\n";
+		for (auto param : ops.parameters[op]) {
+			write_multiline_comment(out, spec.strings[spec.parameters.description[param]], "\t");
+			// out << "\t" << JsonTypeToCppType(parameter["type"].get_string()) << ' ' << parameter["name"].get_string() << ";\n";
 		}
-	}
+		out << "}\n\n";
+	});
 }
 
 // Writes header and impl files for nghttp2.
-void nghttp2(const fs::path& input, const fs::path& output, openapi::OpenAPI2& file) {
+void nghttp2(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
 	fs::path paths_header = output / (input.stem().string() + "_paths.hpp");
 	fs::path paths_impl = output / (input.stem().string() + "_paths.cpp");
 	fs::path paths_stub = output / (input.stem().string() + "_paths_stub.cpp");
 	fs::path defs_file = output / (input.stem().string() + "_defs.hpp");
+	fs::path router_header = output / (input.stem().string() + "_router.hpp");
 
-	auto out = std::ofstream(paths_header);
+	router(input, output, spec);
+
+	auto out = OutputFile(paths_header);
 	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n';
-	WriteHeader(out, file);
+	WriteHeader(out, spec);
 
-	out = std::ofstream(paths_impl);
+	out = OutputFile(paths_impl);
 	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n';
-	out << "#include \"" << paths_header.filename().string() << "\"\n\n";
-	WriteImpl(out, file);
+	out << "#include \"" << paths_header.filename().string() << "\"\n";
+	out << "#include \"" << router_header.filename().string() << "\"\n\n";
+	WriteImpl(out, spec);
 
-	out = std::ofstream(paths_stub);
+	out = OutputFile(paths_stub);
 	out << "#include \"" << defs_file.filename().string() << "\"\n\n";
 	out << "#include \"" << paths_header.filename().string() << "\"\n\n";
-	WriteStub(out, file);
+	WriteStub(out, spec);
 }
@@ -1,5 +1,20 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OPENAPI_HAS_MMAP 1
+#endif
+
 #include "openapi2.hpp"
 #include "util.hpp"
+#include "yaml.hpp"
 
 using namespace std::literals;
 
@@ -75,13 +90,22 @@ bool Property::IsReference() const noexcept {
 	return reference().starts_with(def_refstr);
 }
 
-JsonType Property::Print(std::ostream& out, std::string_view name_, std::string& indent) const {
+// Name of the C++ type a $ref points to.
+static std::string_view ReferenceTypeName(std::string_view ref, const ReferenceIndex* refs) {
+	if (refs) {
+		if (const auto* entry = refs->find(ref)) {
+			return entry->type_name;
+		}
+	}
+	ref.remove_prefix(def_refstr.size());
+	return ref;
+}
+
+JsonType Property::Print(std::ostream& out, std::string_view name_, std::string& indent, const ReferenceIndex* refs) const {
 	std::string name = sanitize(name_);
 	write_multiline_comment(out, description(), indent);
 	if (this->IsReference()) {
-		auto ref = this->reference();
-		ref.remove_prefix(def_refstr.size());
-		out << indent << ref << " obj;\n";
+		out << indent << ReferenceTypeName(this->reference(), refs) << " obj;\n";
 		return JsonType::Reference;
 	}
 	JsonType type = JsonType::Object;
@@ -90,7 +114,7 @@ JsonType Property::Print(std::ostream& out, std::string_view name_, std::string&
 		out << indent << "struct " << name << " {\n";
 		indent.push_back('\t');
 		for (const auto& [subpropname, subprop] : this->properties()) {
-			auto rettype = subprop.Print(out, subpropname, indent);
+			auto rettype = subprop.Print(out, subpropname, indent, refs);
 			if (rettype == JsonType::Object) {
 				out << indent << sanitize(subpropname) << ' ' << subpropname << "_;\n";
 			}
@@ -104,9 +128,7 @@ JsonType Property::Print(std::ostream& out, std::string_view name_, std::string&
 		type = JsonType::Array;
 		auto item = this->items();
 		if (item.IsReference()) {
-			auto ref = item.reference();
-			ref.remove_prefix(def_refstr.size());
-			out << indent << "using " << name << " = std::vector<" << ref << ">;\n";
+			out << indent << "using " << name << " = std::vector<" << ReferenceTypeName(item.reference(), refs) << ">;\n";
 		} else {
 			if (item.type() != "object" && item.type() != "array") {
 				// If this is a top-level declaration, then we should use 'using'.
@@ -119,7 +141,7 @@ JsonType Property::Print(std::ostream& out, std::string_view name_, std::string&
 				// TODO
 			} else {
 				auto nested_typename = std::string(name) + '_';
-				item.Print(out, nested_typename, indent);
+				item.Print(out, nested_typename, indent, refs);
 				if (indent.empty()) {
 					out << indent << "using " << name << " = " << "std::vector<" << nested_typename << ">;\n";
 				} else {
@@ -199,30 +221,252 @@ std::string_view Info::description() const { return _GetValueIfExist<std::string
 std::string_view Info::terms_of_service() const { return _GetValueIfExist<std::string_view>("terms_of_service"); }
 std::string_view Info::version() const { return _GetValueIfExist<std::string_view>("version"); }
 
+namespace __detail {
+
+PaddedMapping::PaddedMapping(PaddedMapping&& other) noexcept
+	: _base(std::exchange(other._base, nullptr))
+	, _len(std::exchange(other._len, 0))
+	, _maplen(std::exchange(other._maplen, 0)) {}
+
+PaddedMapping& PaddedMapping::operator=(PaddedMapping&& other) noexcept {
+	if (this != &other) {
+		Unmap();
+		_base = std::exchange(other._base, nullptr);
+		_len = std::exchange(other._len, 0);
+		_maplen = std::exchange(other._maplen, 0);
+	}
+	return *this;
+}
+
+bool PaddedMapping::Map(const std::string& path) {
+	Unmap();
+#ifdef OPENAPI_HAS_MMAP
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	const size_t len = static_cast<size_t>(st.st_size);
+	const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	const size_t tail = len % page;
+
+	// If the padding fits in the zero-filled remainder of the last page, mapping the file is enough.
+	// Otherwise reserve zeroed anonymous memory for file + padding and map the file over its start.
+	const bool fits = tail != 0 && page - tail >= simdjson::SIMDJSON_PADDING;
+	const size_t maplen = fits ? len : len + simdjson::SIMDJSON_PADDING;
+	void* base = MAP_FAILED;
+	if (fits) {
+		base = ::mmap(nullptr, maplen, PROT_READ, MAP_PRIVATE, fd, 0);
+	} else {
+		base = ::mmap(nullptr, maplen, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base != MAP_FAILED && ::mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			::munmap(base, maplen);
+			base = MAP_FAILED;
+		}
+	}
+	::close(fd);
+	if (base == MAP_FAILED) {
+		return false;
+	}
+	// Both front ends read the input front to back.
+	::madvise(base, maplen, MADV_SEQUENTIAL);
+	_base = base;
+	_len = len;
+	_maplen = maplen;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void PaddedMapping::Unmap() noexcept {
+#ifdef OPENAPI_HAS_MMAP
+	if (_base) {
+		::munmap(_base, _maplen);
+	}
+#endif
+	_base = nullptr;
+	_len = 0;
+	_maplen = 0;
+}
+
+} // namespace __detail
+
+void ReferenceIndex::Build(const simdjson::dom::element& root) {
+	_index.clear();
+	// Sections of a swagger document that $ref may point into.
+	constexpr auto sections = std::array{"definitions"sv, "parameters"sv, "responses"sv};
+	for (const auto& section : sections) {
+		simdjson::dom::object obj;
+		if (root[section].get(obj) != simdjson::SUCCESS) {
+			continue;
+		}
+		std::string prefix = "#/" + std::string(section) + '/';
+		_index.reserve(_index.size() + obj.size());
+		for (const auto& [key, value] : obj) {
+			_index.emplace(prefix + json_pointer_escape(key), Entry{value, sanitize(key)});
+		}
+	}
+}
+
+const ReferenceIndex::Entry* ReferenceIndex::find(std::string_view reference) const {
+	auto it = reference.starts_with("#/") ? _index.find(reference) : _index.find(std::string(def_refstr) + json_pointer_escape(reference));
+	return it != _index.end() ? &it->second : nullptr;
+}
+
 OpenAPI2::OpenAPI2(OpenAPI2&& other) noexcept
 	: _parser(std::move(other._parser))
-	, _root(std::move(other._root)) {}
+	, _root(std::move(other._root))
+	, _refs(std::move(other._refs))
+	, _paths(std::move(other._paths))
+	, _definitions(std::move(other._definitions))
+	, _buffer(std::move(other._buffer))
+	, _buffer_capacity(std::exchange(other._buffer_capacity, 0)) {}
 
 Info OpenAPI2::info() const { return _GetObjectIfExist<Info>("info"); }
 OpenAPI2::Servers OpenAPI2::servers() const { return _GetObjectIfExist<OpenAPI2::Servers>("servers"); }
-OpenAPI2::Paths OpenAPI2::paths() const { return _GetObjectIfExist<OpenAPI2::Paths>("paths"); }
-OpenAPI2::Definitions OpenAPI2::definitions() const { return _GetObjectIfExist<OpenAPI2::Definitions>("definitions"); }
+OpenAPI2::Paths OpenAPI2::paths() const { return _paths; }
+OpenAPI2::Definitions OpenAPI2::definitions() const { return _definitions; }
 
 std::string_view OpenAPI2::openapi() const { return _GetObjectIfExist<std::string_view>("openapi"); }
 
-// Should return false if JSON parsing fails or if file is not an OpenAPI swagger file.
-bool OpenAPI2::Load(const std::string& path) {
-	_root = _parser.load(path);
+char* OpenAPI2::_ReserveBuffer(size_t len) {
+	const size_t needed = len + simdjson::SIMDJSON_PADDING;
+	if (needed > _buffer_capacity) {
+		_buffer_capacity = std::max(needed, _buffer_capacity + _buffer_capacity / 2);
+		_buffer = std::make_unique_for_overwrite<char[]>(_buffer_capacity);
+	}
+	std::fill_n(_buffer.get() + len, simdjson::SIMDJSON_PADDING, '\0');
+	return _buffer.get();
+}
+
+bool OpenAPI2::_Parse(simdjson::padded_string_view json) {
+	// The parser keeps its tape and string buffer between calls and only grows them when needed.
+	return _SetRoot(_parser.parse(json).get(_root) == simdjson::SUCCESS);
+}
+
+bool OpenAPI2::_SetRoot(bool parsed) {
+	if (!parsed) {
+		_root = simdjson::dom::element();
+		_json = _root;
+		_is_valid = false;
+		_refs.clear();
+		_paths = Paths();
+		_definitions = Definitions();
+		return false;
+	}
 	_json = _root;
+	_is_valid = true;
+	_refs.Build(_root);
+	_paths = _GetObjectIfExist<Paths>("paths");
+	_definitions = _GetObjectIfExist<Definitions>("definitions");
 	return true;
 }
 
-Property OpenAPI2::GetDefinedSchemaByReference(std::string_view reference) {
-	if (reference.starts_with(def_refstr)) { reference.remove_prefix(def_refstr.size()); }
-	for (const auto& [schemaname, schema] : definitions()) {
-		if (schemaname == reference) { return schema; }
+// Should return false if JSON parsing fails or if file is not an OpenAPI swagger file.
+bool OpenAPI2::Load(const std::string& path) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in) {
+		return false;
+	}
+	const auto len = static_cast<size_t>(in.tellg());
+	char* buf = _ReserveBuffer(len);
+	in.seekg(0);
+	if (!in.read(buf, len)) {
+		return false;
+	}
+	return _Parse(simdjson::padded_string_view(buf, len, _buffer_capacity));
+}
+
+bool OpenAPI2::Load(simdjson::padded_string_view json) {
+	if (json.padding() < simdjson::SIMDJSON_PADDING) {
+		return LoadBuffer(json);
 	}
-	return Property();
+	return _Parse(json);
+}
+
+bool OpenAPI2::LoadBuffer(std::string_view json) {
+	char* buf = _ReserveBuffer(json.size());
+	std::copy(json.begin(), json.end(), buf);
+	return _Parse(simdjson::padded_string_view(buf, json.size(), _buffer_capacity));
+}
+
+bool OpenAPI2::LoadYaml(std::string_view yaml, std::string* error) {
+	// The tape goes into the parser's own document, which then owns it exactly as after parsing JSON.
+	const bool parsed = ParseYaml(yaml, _parser.doc, error);
+	if (parsed) {
+		_root = _parser.doc.root();
+	}
+	return _SetRoot(parsed);
+}
+
+bool OpenAPI2::LoadMapped(const std::string& path) {
+	__detail::PaddedMapping mapping;
+	if (!mapping.Map(path)) {
+		return Load(path);
+	}
+	// The DOM copies everything it needs out of the input, so the mapping can go as soon as parsing is done.
+	return _Parse(mapping.view());
+}
+
+OpenAPI2::DocumentStats OpenAPI2::Stats() const noexcept {
+	DocumentStats stats;
+	const auto& doc = _parser.doc;
+	if (!_is_valid || !doc.tape) {
+		return stats;
+	}
+	// Capacities follow simdjson's document::allocate: one tape word per input byte, 5/3 string bytes per input byte.
+	const size_t capacity = doc.capacity();
+	stats.tape_capacity = ((capacity + 3 + 63) / 64) * 64 * sizeof(uint64_t);
+	stats.string_capacity = ((5 * capacity / 3 + simdjson::SIMDJSON_PADDING + 63) / 64) * 64;
+
+	// The root word at the start of the tape holds the index of the root word at its end.
+	constexpr uint64_t payload_mask = (uint64_t(1) << 56) - 1;
+	const uint64_t* tape = doc.tape.get();
+	const size_t words = (tape[0] & payload_mask) + 1;
+	stats.tape_bytes = words * sizeof(uint64_t);
+	for (size_t i = 1; i + 1 < words; ++i) {
+		switch (static_cast<char>(tape[i] >> 56)) {
+		case '{':
+			++stats.objects;
+			break;
+		case '[':
+			++stats.arrays;
+			break;
+		case '"': {
+			// Strings are stored as a 32-bit length, the bytes and a terminating NUL.
+			const size_t offset = tape[i] & payload_mask;
+			uint32_t len;
+			std::memcpy(&len, doc.string_buf.get() + offset, sizeof(len));
+			stats.string_bytes = std::max(stats.string_bytes, offset + sizeof(len) + len + 1);
+			++stats.strings;
+			break;
+		}
+		case 'l':
+		case 'u':
+		case 'd':
+			++stats.numbers;
+			++i; // The value takes the next word.
+			break;
+		case 't':
+		case 'f':
+		case 'n':
+			++stats.literals;
+			break;
+		default:
+			break;
+		}
+	}
+	return stats;
+}
+
+Property OpenAPI2::GetDefinedSchemaByReference(std::string_view reference) const {
+	const auto* entry = _refs.find(reference);
+	return entry ? Property(simdjson::dom::element(entry->element)) : Property();
 }
 
 std::string SynthesizeFunctionName(std::string_view pathstr, RequestMethod verb) {
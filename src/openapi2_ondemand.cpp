@@ -0,0 +1,69 @@
+#include "openapi2_ondemand.hpp"
+
+namespace openapi::ondemand {
+
+std::string_view Property::type() const { return _GetValueIfExist<std::string_view>("type"); }
+std::string_view Property::description() const { return _GetValueIfExist<std::string_view>("description"); }
+std::string_view Property::pattern() const { return _GetValueIfExist<std::string_view>("pattern"); }
+std::string_view Property::format() const { return _GetValueIfExist<std::string_view>("format"); }
+std::string_view Property::reference() const { return _GetValueIfExist<std::string_view>("$ref"); }
+StringList Property::enum_() const { return _GetObjectIfExist<StringList>("enum"); }
+Property Property::items() const { return _GetObjectIfExist<Property>("items"); }
+Property::Properties Property::properties() const { return _GetObjectIfExist<Property::Properties>("properties"); }
+
+std::string_view Response::description() const { return _GetValueIfExist<std::string_view>("description"); }
+Property Response::schema() const { return _GetObjectIfExist<Property>("schema"); }
+
+std::string_view Parameter::name() const { return _GetValueIfExist<std::string_view>("name"); }
+std::string_view Parameter::in() const { return _GetValueIfExist<std::string_view>("in"); }
+std::string_view Parameter::description() const { return _GetValueIfExist<std::string_view>("description"); }
+bool Parameter::required() const { return _GetValueIfExist<bool>("required"); }
+std::string_view Parameter::type() const { return _GetValueIfExist<std::string_view>("type"); }
+std::string_view Parameter::format() const { return _GetValueIfExist<std::string_view>("format"); }
+Property Parameter::schema() const { return _GetObjectIfExist<Property>("schema"); }
+
+std::string_view Operation::summary() const { return _GetValueIfExist<std::string_view>("summary"); }
+std::string_view Operation::description() const { return _GetValueIfExist<std::string_view>("description"); }
+std::string_view Operation::operation_id() const { return _GetValueIfExist<std::string_view>("operationId"); }
+bool Operation::deprecated() const { return _GetValueIfExist<bool>("deprecated"); }
+Operation::Responses Operation::responses() const { return _GetObjectIfExist<Operation::Responses>("responses"); }
+Operation::Parameters Operation::parameters() const { return _GetObjectIfExist<Operation::Parameters>("parameters"); }
+Operation::Tags Operation::tags() const { return _GetObjectIfExist<Operation::Tags>("tags"); }
+
+bool OpenAPI2::_Section(std::string_view key, simdjson::ondemand::value& value) {
+	if (!_is_valid) {
+		return false;
+	}
+	_doc.rewind();
+	return _doc[key].get(value) == simdjson::SUCCESS;
+}
+
+OpenAPI2::Paths OpenAPI2::paths() {
+	simdjson::ondemand::value value;
+	return _Section("paths", value) ? Paths(value) : Paths();
+}
+
+OpenAPI2::Definitions OpenAPI2::definitions() {
+	simdjson::ondemand::value value;
+	return _Section("definitions", value) ? Definitions(value) : Definitions();
+}
+
+bool OpenAPI2::Load(const std::string& path) {
+	_owned = simdjson::padded_string();
+	if (_mapping.Map(path)) {
+		return Load(_mapping.view());
+	}
+	if (simdjson::padded_string::load(path).get(_owned) != simdjson::SUCCESS) {
+		_is_valid = false;
+		return false;
+	}
+	return Load(simdjson::padded_string_view(_owned));
+}
+
+bool OpenAPI2::Load(simdjson::padded_string_view json) {
+	// Only stage 1 (structural indexing) runs here; everything else happens as the document is iterated.
+	_is_valid = _parser.iterate(json).get(_doc) == simdjson::SUCCESS;
+	return _is_valid;
+}
+
+} // namespace openapi::ondemand
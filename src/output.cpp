@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define OUTPUT_HAS_POSIX_IO 1
+#endif
+
+#include "output.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+
+static std::mutex g_outputs_mutex;
+static std::vector<OutputRecord> g_outputs;
+
+static bool same_content(const fs::path& path, const std::vector<std::string_view>& chunks, size_t size) {
+	std::error_code ec;
+	if (fs::file_size(path, ec) != size || ec) {
+		return false;
+	}
+	std::ifstream in(path, std::ios::binary);
+	std::string existing(size, '\0');
+	if (!in.read(existing.data(), existing.size())) {
+		return false;
+	}
+	size_t offset = 0;
+	for (auto chunk : chunks) {
+		if (existing.compare(offset, chunk.size(), chunk) != 0) {
+			return false;
+		}
+		offset += chunk.size();
+	}
+	return true;
+}
+
+// Name for a temporary file next to path. Unique within the process; the pid makes it unique across processes.
+static fs::path temporary_path(const fs::path& path) {
+	static std::atomic<unsigned> counter = 0;
+	auto name = path.filename().string() + '.';
+#ifdef OUTPUT_HAS_POSIX_IO
+	name += std::to_string(getpid()) + '.';
+#endif
+	name += std::to_string(counter++) + ".tmp";
+	return path.parent_path() / name;
+}
+
+static bool write_chunks(const fs::path& path, const std::vector<std::string_view>& chunks) {
+#ifdef OUTPUT_HAS_POSIX_IO
+	const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+	if (fd < 0) {
+		return false;
+	}
+	std::vector<iovec> iov;
+	iov.reserve(chunks.size());
+	for (auto chunk : chunks) {
+		iov.push_back(iovec{const_cast<char*>(chunk.data()), chunk.size()});
+	}
+	// One writev covers the file unless it has more than IOV_MAX chunks or the write comes back short.
+	size_t first = 0;
+	bool ok = true;
+	while (ok && first < iov.size()) {
+		const int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+		const ssize_t written = writev(fd, iov.data() + first, count);
+		if (written < 0) {
+			ok = errno == EINTR;
+			continue;
+		}
+		for (size_t left = static_cast<size_t>(written); left > 0 && first < iov.size();) {
+			const size_t step = std::min(left, iov[first].iov_len);
+			iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + step;
+			iov[first].iov_len -= step;
+			left -= step;
+			if (iov[first].iov_len == 0) {
+				++first;
+			}
+		}
+	}
+	return close(fd) == 0 && ok;
+#else
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	for (auto chunk : chunks) {
+		out.write(chunk.data(), chunk.size());
+	}
+	out.close();
+	return static_cast<bool>(out);
+#endif
+}
+
+bool replace_file(const fs::path& path, const std::vector<std::string_view>& chunks) {
+	const auto temporary = temporary_path(path);
+	std::error_code ec;
+	if (write_chunks(temporary, chunks)) {
+		fs::rename(temporary, path, ec);
+		if (!ec) {
+			return true;
+		}
+	}
+	fs::remove(temporary, ec);
+	return false;
+}
+
+ChunkedBuffer::ChunkedBuffer(ChunkedBuffer&& other) noexcept
+	: std::streambuf(other) // Chunks are heap-allocated, so the put area stays valid when the list moves.
+	, _chunks(std::move(other._chunks)) {
+	other.setp(nullptr, nullptr);
+}
+
+ChunkedBuffer& ChunkedBuffer::operator=(ChunkedBuffer&& other) noexcept {
+	if (this != &other) {
+		setp(other.pbase(), other.epptr());
+		pbump(static_cast<int>(other.pptr() - other.pbase()));
+		_chunks = std::move(other._chunks);
+		other.setp(nullptr, nullptr);
+	}
+	return *this;
+}
+
+size_t ChunkedBuffer::size() const noexcept {
+	return _chunks.empty() ? 0 : (_chunks.size() - 1) * kChunkSize + static_cast<size_t>(pptr() - pbase());
+}
+
+std::vector<std::string_view> ChunkedBuffer::chunks() const {
+	std::vector<std::string_view> result;
+	result.reserve(_chunks.size());
+	for (size_t i = 0; i + 1 < _chunks.size(); ++i) {
+		result.emplace_back(_chunks[i].get(), kChunkSize);
+	}
+	if (pptr() != pbase()) {
+		result.emplace_back(pbase(), static_cast<size_t>(pptr() - pbase()));
+	}
+	return result;
+}
+
+void ChunkedBuffer::clear() noexcept {
+	_chunks.clear();
+	setp(nullptr, nullptr);
+}
+
+ChunkedBuffer::int_type ChunkedBuffer::overflow(int_type ch) {
+	if (traits_type::eq_int_type(ch, traits_type::eof())) {
+		return traits_type::not_eof(ch);
+	}
+	_chunks.push_back(std::make_unique_for_overwrite<char[]>(kChunkSize));
+	setp(_chunks.back().get(), _chunks.back().get() + kChunkSize);
+	*pptr() = traits_type::to_char_type(ch);
+	pbump(1);
+	return ch;
+}
+
+std::streamsize ChunkedBuffer::xsputn(const char* s, std::streamsize n) {
+	for (std::streamsize left = n; left > 0;) {
+		if (pptr() == epptr()) {
+			overflow(traits_type::to_int_type(*s++));
+			--left;
+			continue;
+		}
+		const auto step = std::min<std::streamsize>(left, epptr() - pptr());
+		std::memcpy(pptr(), s, static_cast<size_t>(step));
+		pbump(static_cast<int>(step));
+		s += step;
+		left -= step;
+	}
+	return n;
+}
+
+OutputFile::OutputFile()
+	: std::ostream(nullptr) {
+	rdbuf(&_buffer);
+}
+
+OutputFile::OutputFile(fs::path path)
+	: std::ostream(nullptr)
+	, _path(std::move(path)) {
+	rdbuf(&_buffer);
+}
+
+OutputFile::OutputFile(OutputFile&& other)
+	: std::ostream(std::move(other))
+	, _buffer(std::move(other._buffer))
+	, _path(std::move(other._path)) {
+	set_rdbuf(&_buffer);
+	other._path.clear();
+}
+
+OutputFile& OutputFile::operator=(OutputFile&& other) {
+	if (this != &other) {
+		Commit();
+		std::ostream::operator=(std::move(other));
+		_buffer = std::move(other._buffer);
+		set_rdbuf(&_buffer);
+		_path = std::move(other._path);
+		other._path.clear();
+	}
+	return *this;
+}
+
+OutputFile::~OutputFile() {
+	Commit();
+}
+
+bool OutputFile::Commit() {
+	if (_path.empty()) {
+		return true;
+	}
+	const auto chunks = _buffer.chunks();
+	const auto size = _buffer.size();
+	uint64_t hash = fnv1a({});
+	for (auto chunk : chunks) {
+		hash = fnv1a(chunk, hash);
+	}
+	const bool unchanged = same_content(_path, chunks, size);
+	const bool ok = unchanged || replace_file(_path, chunks);
+	{
+		std::lock_guard lock(g_outputs_mutex);
+		g_outputs.push_back(OutputRecord{_path, hash, size, !unchanged});
+	}
+	_path.clear();
+	_buffer.clear();
+	return ok;
+}
+
+std::vector<OutputRecord> committed_outputs() {
+	std::lock_guard lock(g_outputs_mutex);
+	return g_outputs;
+}
@@ -0,0 +1,702 @@
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <queue>
+#include <string>
+
+#include "pattern_dfa.hpp"
+
+namespace {
+
+using ByteSet = std::bitset<256>;
+
+constexpr size_t kMaxRepeat = 1000;
+constexpr size_t kMaxNfaStates = 100000;
+
+ByteSet Range(unsigned lo, unsigned hi) {
+	ByteSet set;
+	for (unsigned c = lo; c <= hi; ++c) {
+		set.set(c);
+	}
+	return set;
+}
+
+const ByteSet kAscii = Range(0, 0x7f);
+const ByteSet kDigit = Range('0', '9');
+const ByteSet kWord = Range('0', '9') | Range('A', 'Z') | Range('a', 'z') | Range('_', '_');
+const ByteSet kSpace = Range('\t', '\r') | Range(' ', ' ');
+
+// Regex syntax tree. Nodes refer to each other by index into nodes.
+struct Ast {
+	enum class Kind { Set, Concat, Alt, Repeat, Empty };
+	struct Node {
+		Kind kind = Kind::Empty;
+		ByteSet set;               // Set: the bytes this node matches.
+		std::vector<int> children; // Concat, Alt, and the single child of Repeat.
+		size_t min = 0;
+		size_t max = 0;            // Repeat: upper bound, or SIZE_MAX if unbounded.
+	};
+	std::vector<Node> nodes;
+
+	int Add(Node node) {
+		nodes.push_back(std::move(node));
+		return static_cast<int>(nodes.size()) - 1;
+	}
+	int Set(const ByteSet& set) { return Add(Node{Kind::Set, set, {}, 0, 0}); }
+	int Concat(std::vector<int> children) { return Add(Node{Kind::Concat, {}, std::move(children), 0, 0}); }
+	int Alt(std::vector<int> children) { return Add(Node{Kind::Alt, {}, std::move(children), 0, 0}); }
+
+	// Any single non-ASCII code point, as a UTF-8 byte sequence.
+	int NonAscii() {
+		const auto cont = Range(0x80, 0xbf);
+		return Alt({
+			Concat({Set(Range(0xc2, 0xdf)), Set(cont)}),
+			Concat({Set(Range(0xe0, 0xef)), Set(cont), Set(cont)}),
+			Concat({Set(Range(0xf0, 0xf4)), Set(cont), Set(cont), Set(cont)}),
+		});
+	}
+
+	int Literal(std::string_view bytes) {
+		std::vector<int> children;
+		for (unsigned char c : bytes) {
+			ByteSet set;
+			set.set(c);
+			children.push_back(Set(set));
+		}
+		return children.size() == 1 ? children.front() : Concat(std::move(children));
+	}
+};
+
+std::string EncodeUtf8(uint32_t cp) {
+	std::string out;
+	if (cp < 0x80) {
+		out += static_cast<char>(cp);
+	} else if (cp < 0x800) {
+		out += static_cast<char>(0xc0 | (cp >> 6));
+		out += static_cast<char>(0x80 | (cp & 0x3f));
+	} else {
+		out += static_cast<char>(0xe0 | (cp >> 12));
+		out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+		out += static_cast<char>(0x80 | (cp & 0x3f));
+	}
+	return out;
+}
+
+size_t Utf8Length(unsigned char lead) {
+	return lead < 0xc0 ? 1 : lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : 4;
+}
+
+int HexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Recursive descent over the ECMA-262 subset described in pattern_dfa.hpp.
+// Any failure leaves _ok false; the caller then discards the tree.
+class Parser {
+public:
+	Parser(std::string_view pattern, Ast& ast)
+		: _p(pattern), _ast(ast) {}
+
+	int Parse() {
+		const int root = _Alternation();
+		return _ok && _i == _p.size() ? root : -1;
+	}
+
+private:
+	// One escaped character: a set of bytes, a literal (possibly multi-byte) or, for \D \W \S, a negated set.
+	struct Escape {
+		ByteSet set;
+		std::string literal;
+		bool negated = false;
+	};
+
+	bool _Fail() { _ok = false; return false; }
+	bool _AtEnd() const noexcept { return _i >= _p.size(); }
+
+	int _Alternation() {
+		std::vector<int> alternatives{_Sequence()};
+		while (_ok && !_AtEnd() && _p[_i] == '|') {
+			++_i;
+			alternatives.push_back(_Sequence());
+		}
+		return alternatives.size() == 1 ? alternatives.front() : _ast.Alt(std::move(alternatives));
+	}
+
+	int _Sequence() {
+		std::vector<int> items;
+		while (_ok && !_AtEnd() && _p[_i] != '|' && _p[_i] != ')') {
+			items.push_back(_Quantified());
+		}
+		return _ast.Concat(std::move(items));
+	}
+
+	int _Quantified() {
+		int atom = _Atom();
+		while (_ok && !_AtEnd()) {
+			size_t min = 0, max = 0;
+			const char c = _p[_i];
+			if (c == '*') {
+				min = 0, max = SIZE_MAX, ++_i;
+			} else if (c == '+') {
+				min = 1, max = SIZE_MAX, ++_i;
+			} else if (c == '?') {
+				min = 0, max = 1, ++_i;
+			} else if (c != '{' || !_Braces(min, max)) {
+				break;
+			}
+			// Laziness changes which match is found, never whether one is.
+			if (!_AtEnd() && _p[_i] == '?') {
+				++_i;
+			}
+			if (min > kMaxRepeat || (max != SIZE_MAX && (max > kMaxRepeat || max < min))) {
+				_Fail();
+				break;
+			}
+			atom = _ast.Add(Ast::Node{Ast::Kind::Repeat, {}, {atom}, min, max});
+		}
+		return atom;
+	}
+
+	// {n}, {n,} or {n,m}. Anything else is a literal '{', as in web browsers.
+	bool _Braces(size_t& min, size_t& max) {
+		size_t j = _i + 1;
+		auto number = [&](size_t& value) {
+			const size_t start = j;
+			value = 0;
+			while (j < _p.size() && _p[j] >= '0' && _p[j] <= '9' && value <= kMaxRepeat) {
+				value = value * 10 + static_cast<size_t>(_p[j++] - '0');
+			}
+			return j != start;
+		};
+		if (!number(min)) {
+			return false;
+		}
+		max = min;
+		if (j < _p.size() && _p[j] == ',') {
+			++j;
+			if (!number(max)) {
+				max = SIZE_MAX;
+			}
+		}
+		if (j >= _p.size() || _p[j] != '}') {
+			return false;
+		}
+		_i = j + 1;
+		return true;
+	}
+
+	int _Atom() {
+		const unsigned char c = static_cast<unsigned char>(_p[_i]);
+		switch (c) {
+		case '(': {
+			++_i;
+			if (!_AtEnd() && _p[_i] == '?') {
+				// Only non-capturing groups; lookaround and named groups are rejected.
+				if (_i + 1 >= _p.size() || _p[_i + 1] != ':') {
+					_Fail();
+					return -1;
+				}
+				_i += 2;
+			}
+			const int inner = _Alternation();
+			if (_AtEnd() || _p[_i] != ')') {
+				_Fail();
+				return -1;
+			}
+			++_i;
+			return inner;
+		}
+		case '[':
+			return _Class();
+		case '.':
+			++_i;
+			return _ast.Alt({_ast.Set(kAscii & ~(Range('\n', '\n') | Range('\r', '\r'))), _ast.NonAscii()});
+		case '\\': {
+			++_i;
+			Escape esc;
+			if (!_Escape(esc, false)) {
+				return -1;
+			}
+			if (!esc.literal.empty()) {
+				return _ast.Literal(esc.literal);
+			}
+			return esc.negated ? _ast.Alt({_ast.Set(kAscii & ~esc.set), _ast.NonAscii()}) : _ast.Set(esc.set);
+		}
+		case '^':
+		case '$':
+		case '*':
+		case '+':
+		case '?':
+			// Anchors are only supported at the ends of the pattern, where Compile removes them.
+			_Fail();
+			return -1;
+		default: {
+			const size_t len = std::min(Utf8Length(c), _p.size() - _i);
+			const int literal = _ast.Literal(_p.substr(_i, len));
+			_i += len;
+			return literal;
+		}
+		}
+	}
+
+	// Called after the backslash.
+	bool _Escape(Escape& esc, bool in_class) {
+		if (_AtEnd()) {
+			return _Fail();
+		}
+		const char c = _p[_i++];
+		switch (c) {
+		case 'd': esc.set = kDigit; return true;
+		case 'w': esc.set = kWord; return true;
+		case 's': esc.set = kSpace; return true;
+		case 'D': esc.set = kDigit, esc.negated = true; return true;
+		case 'W': esc.set = kWord, esc.negated = true; return true;
+		case 'S': esc.set = kSpace, esc.negated = true; return true;
+		case 'n': esc.literal = "\n"; return true;
+		case 'r': esc.literal = "\r"; return true;
+		case 't': esc.literal = "\t"; return true;
+		case 'f': esc.literal = "\f"; return true;
+		case 'v': esc.literal = "\v"; return true;
+		case '0': esc.literal = std::string(1, '\0'); return true;
+		case 'b':
+			// Backspace in a class, a word boundary outside one.
+			if (!in_class) {
+				return _Fail();
+			}
+			esc.literal = "\b";
+			return true;
+		case 'x':
+		case 'u': {
+			const size_t digits = c == 'x' ? 2 : 4;
+			if (_i + digits > _p.size()) {
+				return _Fail();
+			}
+			uint32_t cp = 0;
+			for (size_t k = 0; k < digits; ++k) {
+				const int v = HexValue(_p[_i + k]);
+				if (v < 0) {
+					return _Fail();
+				}
+				cp = cp * 16 + static_cast<uint32_t>(v);
+			}
+			_i += digits;
+			esc.literal = EncodeUtf8(cp);
+			return true;
+		}
+		case 'B': case 'c': case 'k': case 'p': case 'P':
+		case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+			return _Fail();
+		default:
+			esc.literal = std::string(1, c);
+			return true;
+		}
+	}
+
+	int _Class() {
+		++_i;
+		bool negated = false;
+		if (!_AtEnd() && _p[_i] == '^') {
+			negated = true;
+			++_i;
+		}
+		ByteSet set;
+		std::vector<std::string> multibyte;
+		bool any_non_ascii = false;
+		while (_ok && !_AtEnd() && _p[_i] != ']') {
+			std::string lo;
+			if (_p[_i] == '\\') {
+				++_i;
+				Escape esc;
+				if (!_Escape(esc, true)) {
+					return -1;
+				}
+				if (esc.literal.empty()) {
+					set |= esc.negated ? kAscii & ~esc.set : esc.set;
+					any_non_ascii |= esc.negated;
+					continue;
+				}
+				lo = esc.literal;
+			} else {
+				const size_t len = std::min(Utf8Length(static_cast<unsigned char>(_p[_i])), _p.size() - _i);
+				lo = _p.substr(_i, len);
+				_i += len;
+			}
+			if (_i + 1 < _p.size() && _p[_i] == '-' && _p[_i + 1] != ']') {
+				++_i;
+				std::string hi;
+				if (_p[_i] == '\\') {
+					++_i;
+					Escape esc;
+					if (!_Escape(esc, true) || esc.literal.empty()) {
+						_Fail();
+						return -1;
+					}
+					hi = esc.literal;
+				} else {
+					hi = _p.substr(_i, 1);
+					++_i;
+				}
+				// Ranges are byte ranges, so both ends must be ASCII.
+				if (lo.size() != 1 || hi.size() != 1 || static_cast<unsigned char>(lo[0]) > 0x7f || static_cast<unsigned char>(hi[0]) > 0x7f || lo[0] > hi[0]) {
+					_Fail();
+					return -1;
+				}
+				set |= Range(static_cast<unsigned char>(lo[0]), static_cast<unsigned char>(hi[0]));
+			} else if (lo.size() == 1 && static_cast<unsigned char>(lo[0]) <= 0x7f) {
+				set.set(static_cast<unsigned char>(lo[0]));
+			} else {
+				multibyte.push_back(lo);
+			}
+		}
+		if (_AtEnd()) {
+			_Fail();
+			return -1;
+		}
+		++_i; // ']'
+		if (negated) {
+			// A negated class excludes whole code points; that is only expressible for ASCII members.
+			if (!multibyte.empty() || any_non_ascii) {
+				_Fail();
+				return -1;
+			}
+			return _ast.Alt({_ast.Set(kAscii & ~set), _ast.NonAscii()});
+		}
+		std::vector<int> alternatives{_ast.Set(set)};
+		if (any_non_ascii) {
+			alternatives.push_back(_ast.NonAscii());
+		}
+		for (const auto& literal : multibyte) {
+			alternatives.push_back(_ast.Literal(literal));
+		}
+		return alternatives.size() == 1 ? alternatives.front() : _ast.Alt(std::move(alternatives));
+	}
+
+	std::string_view _p;
+	Ast& _ast;
+	size_t _i = 0;
+	bool _ok = true;
+};
+
+// Thompson construction. Each state has at most one byte-set transition, plus any number of epsilon edges.
+struct Nfa {
+	struct State {
+		ByteSet set;
+		int next = -1;
+		std::vector<int> eps;
+	};
+	struct Fragment {
+		int start;
+		int end;
+	};
+	std::vector<State> states;
+	bool overflow = false;
+
+	int New() {
+		if (states.size() >= kMaxNfaStates) {
+			overflow = true;
+		}
+		states.emplace_back();
+		return static_cast<int>(states.size()) - 1;
+	}
+
+	Fragment Build(const Ast& ast, int id) {
+		if (overflow) {
+			return Fragment{0, 0};
+		}
+		const auto& node = ast.nodes[id];
+		const int start = New();
+		switch (node.kind) {
+		case Ast::Kind::Set: {
+			const int end = New();
+			states[start].set = node.set;
+			states[start].next = end;
+			return Fragment{start, end};
+		}
+		case Ast::Kind::Concat: {
+			int end = start;
+			for (int child : node.children) {
+				const auto f = Build(ast, child);
+				states[end].eps.push_back(f.start);
+				end = f.end;
+			}
+			return Fragment{start, end};
+		}
+		case Ast::Kind::Alt: {
+			const int end = New();
+			for (int child : node.children) {
+				const auto f = Build(ast, child);
+				states[start].eps.push_back(f.start);
+				states[f.end].eps.push_back(end);
+			}
+			return Fragment{start, end};
+		}
+		case Ast::Kind::Repeat: {
+			int end = start;
+			for (size_t i = 0; i < node.min && !overflow; ++i) {
+				const auto f = Build(ast, node.children.front());
+				states[end].eps.push_back(f.start);
+				end = f.end;
+			}
+			if (node.max == SIZE_MAX) {
+				const int hub = New();
+				const auto f = Build(ast, node.children.front());
+				states[end].eps.push_back(hub);
+				states[hub].eps.push_back(f.start);
+				states[f.end].eps.push_back(hub);
+				return Fragment{start, hub};
+			}
+			for (size_t i = node.min; i < node.max && !overflow; ++i) {
+				const auto f = Build(ast, node.children.front());
+				const int skip = New();
+				states[end].eps.push_back(f.start);
+				states[end].eps.push_back(skip);
+				states[f.end].eps.push_back(skip);
+				end = skip;
+			}
+			return Fragment{start, end};
+		}
+		case Ast::Kind::Empty:
+			break;
+		}
+		return Fragment{start, start};
+	}
+
+	// Sorted set of states reachable from seeds through epsilon edges.
+	std::vector<int> Closure(std::vector<int> seeds) const {
+		std::vector<bool> seen(states.size());
+		std::vector<int> result;
+		while (!seeds.empty()) {
+			const int s = seeds.back();
+			seeds.pop_back();
+			if (seen[s]) {
+				continue;
+			}
+			seen[s] = true;
+			result.push_back(s);
+			seeds.insert(seeds.end(), states[s].eps.begin(), states[s].eps.end());
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+};
+
+// Strips a leading '^' and an unescaped trailing '$'.
+std::string_view StripAnchors(std::string_view pattern, bool& anchored_start, bool& anchored_end) {
+	anchored_start = !pattern.empty() && pattern.front() == '^';
+	if (anchored_start) {
+		pattern.remove_prefix(1);
+	}
+	size_t backslashes = 0;
+	while (backslashes + 1 < pattern.size() && pattern[pattern.size() - 2 - backslashes] == '\\') {
+		++backslashes;
+	}
+	anchored_end = !pattern.empty() && pattern.back() == '$' && backslashes % 2 == 0;
+	if (anchored_end) {
+		pattern.remove_suffix(1);
+	}
+	return pattern;
+}
+
+// Splits a pattern at every '|' outside groups, classes and escapes. Anchors bind to these branches, not to the
+// whole pattern: ^a|b$ is (^a)|(b$), which matches "ab".
+std::vector<std::string_view> SplitAlternatives(std::string_view pattern) {
+	std::vector<std::string_view> branches;
+	size_t depth = 0, begin = 0;
+	bool in_class = false;
+	for (size_t i = 0; i < pattern.size(); ++i) {
+		const char c = pattern[i];
+		if (c == '\\') {
+			++i;
+		} else if (in_class) {
+			in_class = c != ']';
+		} else if (c == '[') {
+			in_class = true;
+		} else if (c == '(') {
+			++depth;
+		} else if (c == ')' && depth > 0) {
+			--depth;
+		} else if (c == '|' && depth == 0) {
+			branches.push_back(pattern.substr(begin, i - begin));
+			begin = i + 1;
+		}
+	}
+	branches.push_back(pattern.substr(begin));
+	return branches;
+}
+
+} // namespace
+
+bool PatternDfa::Compile(std::string_view pattern, size_t max_states) {
+	// Each top-level branch is built with its own anchors; an unanchored end matches anything on that side.
+	Nfa nfa;
+	const int start = nfa.New();
+	const int final = nfa.New();
+	for (auto branch : SplitAlternatives(pattern)) {
+		bool anchored_start = false, anchored_end = false;
+		branch = StripAnchors(branch, anchored_start, anchored_end);
+		Ast ast;
+		const int root = Parser(branch, ast).Parse();
+		if (root < 0) {
+			return false;
+		}
+		const auto body = nfa.Build(ast, root);
+		if (nfa.overflow) {
+			return false;
+		}
+		int entry = body.start, exit = body.end;
+		if (!anchored_start) {
+			entry = nfa.New();
+			nfa.states[entry].set.set();
+			nfa.states[entry].next = entry;
+			nfa.states[entry].eps.push_back(body.start);
+		}
+		if (!anchored_end) {
+			exit = nfa.New();
+			nfa.states[body.end].eps.push_back(exit);
+			nfa.states[exit].set.set();
+			nfa.states[exit].next = exit;
+		}
+		nfa.states[start].eps.push_back(entry);
+		nfa.states[exit].eps.push_back(final);
+	}
+	if (nfa.overflow) {
+		return false;
+	}
+
+	// Byte classes: bytes that belong to exactly the same transition sets are interchangeable.
+	{
+		std::vector<ByteSet> sets;
+		for (const auto& state : nfa.states) {
+			if (state.next >= 0 && std::find(sets.begin(), sets.end(), state.set) == sets.end()) {
+				sets.push_back(state.set);
+			}
+		}
+		std::map<std::vector<bool>, uint8_t> signatures;
+		for (unsigned b = 0; b < 256; ++b) {
+			std::vector<bool> signature(sets.size());
+			for (size_t k = 0; k < sets.size(); ++k) {
+				signature[k] = sets[k].test(b);
+			}
+			auto [it, inserted] = signatures.try_emplace(std::move(signature), static_cast<uint8_t>(signatures.size()));
+			_classes[b] = it->second;
+		}
+		_num_classes = signatures.size();
+	}
+	std::vector<unsigned> representative(_num_classes);
+	for (unsigned b = 256; b-- > 0;) {
+		representative[_classes[b]] = b;
+	}
+
+	// Subset construction. The empty set is an ordinary state here: the dead state.
+	std::map<std::vector<int>, uint32_t> ids;
+	std::vector<std::vector<int>> subsets;
+	std::vector<uint32_t> transitions;
+	auto intern = [&](std::vector<int> subset) {
+		auto [it, inserted] = ids.try_emplace(subset, static_cast<uint32_t>(subsets.size()));
+		if (inserted) {
+			subsets.push_back(std::move(subset));
+		}
+		return it->second;
+	};
+	intern(nfa.Closure({start}));
+	for (size_t d = 0; d < subsets.size(); ++d) {
+		if (subsets.size() > max_states * 8) {
+			return false;
+		}
+		for (size_t cls = 0; cls < _num_classes; ++cls) {
+			std::vector<int> moved;
+			for (int s : subsets[d]) {
+				if (nfa.states[s].next >= 0 && nfa.states[s].set.test(representative[cls])) {
+					moved.push_back(nfa.states[s].next);
+				}
+			}
+			const auto next = intern(nfa.Closure(std::move(moved)));
+			transitions.push_back(next);
+		}
+	}
+	std::vector<uint8_t> accepting(subsets.size());
+	for (size_t d = 0; d < subsets.size(); ++d) {
+		accepting[d] = std::binary_search(subsets[d].begin(), subsets[d].end(), final);
+	}
+
+	// Moore minimization: refine the accepting / rejecting partition until no block splits.
+	std::vector<uint32_t> block(subsets.size());
+	for (size_t d = 0; d < subsets.size(); ++d) {
+		block[d] = accepting[d];
+	}
+	size_t num_blocks = 0;
+	for (;;) {
+		std::map<std::vector<uint32_t>, uint32_t> signatures;
+		std::vector<uint32_t> refined(subsets.size());
+		for (size_t d = 0; d < subsets.size(); ++d) {
+			std::vector<uint32_t> signature{block[d]};
+			for (size_t cls = 0; cls < _num_classes; ++cls) {
+				signature.push_back(block[transitions[d * _num_classes + cls]]);
+			}
+			refined[d] = signatures.try_emplace(std::move(signature), static_cast<uint32_t>(signatures.size())).first->second;
+		}
+		block = std::move(refined);
+		if (signatures.size() == num_blocks) {
+			break;
+		}
+		num_blocks = signatures.size();
+	}
+	if (num_blocks > max_states) {
+		return false;
+	}
+
+	// Number the blocks in breadth-first order from the start, so the start state is 0.
+	std::vector<uint32_t> number(num_blocks, kNoState), member(num_blocks);
+	for (size_t d = subsets.size(); d-- > 0;) {
+		member[block[d]] = static_cast<uint32_t>(d);
+	}
+	std::queue<uint32_t> pending;
+	number[block[0]] = 0;
+	pending.push(block[0]);
+	uint32_t count = 1;
+	_transitions.clear();
+	_accepting.clear();
+	while (!pending.empty()) {
+		const auto b = pending.front();
+		pending.pop();
+		const auto d = member[b];
+		_accepting.push_back(accepting[d]);
+		for (size_t cls = 0; cls < _num_classes; ++cls) {
+			const auto target = block[transitions[d * _num_classes + cls]];
+			if (number[target] == kNoState) {
+				number[target] = count++;
+				pending.push(target);
+			}
+			_transitions.push_back(number[target]);
+		}
+	}
+
+	_dead = _sink = kNoState;
+	for (uint32_t s = 0; s < num_states(); ++s) {
+		bool loops = true;
+		for (size_t cls = 0; cls < _num_classes && loops; ++cls) {
+			loops = next(s, static_cast<uint8_t>(cls)) == s;
+		}
+		if (loops) {
+			(_accepting[s] ? _sink : _dead) = s;
+		}
+	}
+	return true;
+}
+
+bool PatternDfa::Matches(std::string_view input) const noexcept {
+	uint32_t state = 0;
+	for (unsigned char c : input) {
+		state = next(state, _classes[c]);
+		if (state == _dead) {
+			return false;
+		}
+		if (state == _sink) {
+			return true;
+		}
+	}
+	return _accepting[state];
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "output.hpp"
+#include "profile.hpp"
+
+namespace {
+
+double NowMs() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Linux can reset the resident-memory high-water mark, which gives a true per-phase peak.
+// Elsewhere the process-wide peak is reported, which only ever grows.
+void ResetPeakRss() {
+#ifdef __linux__
+	std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+size_t PeakRss() {
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	for (std::string line; std::getline(status, line);) {
+		if (line.starts_with("VmHWM:")) {
+			return std::stoull(line.substr(6)) * 1024;
+		}
+	}
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss); // Bytes on macOS.
+#else
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+#endif
+	return 0;
+}
+
+void WriteJsonString(std::ostream& out, std::string_view text) {
+	out << '"';
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			constexpr char hex[] = "0123456789abcdef";
+			out << "\\u00" << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+} // namespace
+
+void Profile::_Begin(std::string_view name) {
+	_phases.push_back(Phase{std::string(name)});
+	_start_outputs = committed_outputs().size();
+	ResetPeakRss();
+	_start_ms = NowMs();
+}
+
+void Profile::_End() {
+	auto& phase = _phases.back();
+	phase.wall_ms = NowMs() - _start_ms;
+	phase.peak_rss = PeakRss();
+	const auto outputs = committed_outputs();
+	for (size_t i = _start_outputs; i < outputs.size(); ++i) {
+		phase.bytes_written += outputs[i].size;
+		++phase.files;
+	}
+}
+
+void Profile::WriteJson(std::ostream& out) const {
+	double total_ms = 0;
+	size_t peak_rss = 0;
+	out << "{\n"
+		<< "  \"phases\": [";
+	for (size_t i = 0; i < _phases.size(); ++i) {
+		const auto& phase = _phases[i];
+		total_ms += phase.wall_ms;
+		peak_rss = std::max(peak_rss, phase.peak_rss);
+		out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+		WriteJsonString(out, phase.name);
+		out << ", \"wall_ms\": " << phase.wall_ms
+			<< ", \"bytes_written\": " << phase.bytes_written
+			<< ", \"files\": " << phase.files
+			<< ", \"peak_rss_bytes\": " << phase.peak_rss << '}';
+	}
+	out << "\n  ],\n";
+	for (const auto& [key, value] : _counters) {
+		out << "  ";
+		WriteJsonString(out, key);
+		out << ": " << value << ",\n";
+	}
+	out << "  \"total_ms\": " << total_ms << ",\n"
+		<< "  \"peak_rss_bytes\": " << peak_rss << '\n'
+		<< "}\n";
+}
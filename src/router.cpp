@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+namespace {
+
+// One segment of a path template, e.g. "pets", "{id}" or "v{version}.json".
+struct Segment {
+	std::string_view prefix; // Literal text before the parameter, or the whole segment if it has none.
+	std::string_view suffix; // Literal text after the parameter.
+	bool is_param = false;
+
+	// Literals are tried first, then parameters with the most literal text around them.
+	bool operator<(const Segment& other) const {
+		if (is_param != other.is_param) {
+			return !is_param;
+		}
+		const auto len = prefix.size() + suffix.size(), other_len = other.prefix.size() + other.suffix.size();
+		if (len != other_len) {
+			return len > other_len;
+		}
+		return std::tie(prefix, suffix) < std::tie(other.prefix, other.suffix);
+	}
+};
+
+Segment ParseSegment(std::string_view seg) {
+	auto open = seg.find('{');
+	auto close = seg.find('}', open);
+	if (open == std::string_view::npos || close == std::string_view::npos) {
+		return Segment{seg, {}, false};
+	}
+	return Segment{seg.substr(0, open), seg.substr(close + 1), true};
+}
+
+struct Node {
+	std::map<Segment, std::unique_ptr<Node>> children;
+	std::vector<uint32_t> operations;
+};
+
+// Builds a segment trie over every path template in the spec.
+Node BuildTrie(const openapi::CompiledSpec& spec) {
+	Node root;
+	for (uint32_t path = 0; path < spec.paths.size(); ++path) {
+		std::string_view pathstr = spec.strings[spec.paths.name[path]];
+		Node* node = &root;
+		while (!pathstr.empty()) {
+			if (pathstr.front() == '/') {
+				pathstr.remove_prefix(1);
+			}
+			const auto segment = pathstr.substr(0, pathstr.find('/'));
+			pathstr.remove_prefix(segment.size());
+			// "/" itself, and doubled or trailing slashes, add no level: match_route drops a trailing slash.
+			if (segment.empty()) {
+				continue;
+			}
+			auto& child = node->children[ParseSegment(segment)];
+			if (!child) {
+				child = std::make_unique<Node>();
+			}
+			node = child.get();
+		}
+		for (auto op : spec.paths.operations[path]) {
+			node->operations.push_back(op);
+		}
+	}
+	return root;
+}
+
+std::string MethodName(openapi::RequestMethod rm) {
+	std::string name(openapi::RequestMethodToString(rm));
+	std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::toupper(c)); });
+	return name;
+}
+
+// Emits matching code for a node. Every branch returns on a match and falls through otherwise,
+// so a failed literal branch goes on to try the parameter branches after it.
+void WriteNode(std::ostream& out, const openapi::CompiledSpec& spec, const Node& node, int depth, int params, std::string& indent) {
+	const auto pos = "p" + std::to_string(depth);
+	if (!node.operations.empty()) {
+		out << indent << "if (" << pos << " == path.size()) {\n"
+			<< indent << "\tm.num_params = " << params << ";\n"
+			<< indent << "\tswitch (method) {\n";
+		for (auto op : node.operations) {
+			out << indent << "\tcase RequestMethod::" << MethodName(spec.operations.method[op]) << ": m.route = Route::" << spec.FunctionName(op) << "; return m;\n";
+		}
+		out << indent << "\tdefault: m.route = Route::MethodNotAllowed; break; // Another template may still match.\n"
+			<< indent << "\t}\n"
+			<< indent << "}\n";
+	}
+	if (node.children.empty()) {
+		return;
+	}
+	const auto seg = "s" + std::to_string(depth);
+	const auto next = "p" + std::to_string(depth + 1);
+	out << indent << "if (" << pos << " < path.size() && path[" << pos << "] == '/') {\n";
+	indent.push_back('\t');
+	out << indent << "const size_t " << next << " = std::min(path.find('/', " << pos << " + 1), path.size());\n"
+		<< indent << "const std::string_view " << seg << " = path.substr(" << pos << " + 1, " << next << " - " << pos << " - 1);\n";
+
+	// Literal children, grouped by length so that most segments are rejected with one integer compare.
+	std::map<size_t, std::vector<const std::pair<const Segment, std::unique_ptr<Node>>*>> literals;
+	for (const auto& child : node.children) {
+		if (!child.first.is_param) {
+			literals[child.first.prefix.size()].push_back(&child);
+		}
+	}
+	if (!literals.empty()) {
+		out << indent << "switch (" << seg << ".size()) {\n";
+		for (const auto& [len, children] : literals) {
+			out << indent << "case " << len << ":\n";
+			indent.push_back('\t');
+			for (const auto* child : children) {
+				out << indent << "if (" << seg << " == \"" << cpp_escape(child->first.prefix) << "\"sv) {\n";
+				indent.push_back('\t');
+				WriteNode(out, spec, *child->second, depth + 1, params, indent);
+				indent.pop_back();
+				out << indent << "}\n";
+			}
+			out << indent << "break;\n";
+			indent.pop_back();
+		}
+		out << indent << "default: break;\n"
+			<< indent << "}\n";
+	}
+
+	for (const auto& [segment, child] : node.children) {
+		if (!segment.is_param) {
+			continue;
+		}
+		const auto fixed = segment.prefix.size() + segment.suffix.size();
+		out << indent << "if (" << seg << ".size() > " << fixed;
+		if (!segment.prefix.empty()) {
+			out << " && " << seg << ".starts_with(\"" << cpp_escape(segment.prefix) << "\"sv)";
+		}
+		if (!segment.suffix.empty()) {
+			out << " && " << seg << ".ends_with(\"" << cpp_escape(segment.suffix) << "\"sv)";
+		}
+		out << ") {\n";
+		indent.push_back('\t');
+		out << indent << "m.params[" << params << "] = " << seg;
+		if (fixed != 0) {
+			out << ".substr(" << segment.prefix.size() << ", " << seg << ".size() - " << fixed << ")";
+		}
+		out << ";\n";
+		WriteNode(out, spec, *child, depth + 1, params + 1, indent);
+		indent.pop_back();
+		out << indent << "}\n";
+	}
+	indent.pop_back();
+	out << indent << "}\n";
+}
+
+int MaxParams(const Node& node) {
+	int max = 0;
+	for (const auto& [segment, child] : node.children) {
+		max = std::max(max, MaxParams(*child) + (segment.is_param ? 1 : 0));
+	}
+	return max;
+}
+
+} // namespace
+
+// Writes a router header: a segment trie over the path templates, compiled to nested switches.
+// Matching is allocation-free (captures are views into the target) and its cost depends on the depth of the path,
+// not on the number of routes.
+void router(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	const Node root = BuildTrie(spec);
+	// One enumerator per operation, then NotFound and MethodNotAllowed.
+	const auto route_type = spec.operations.size() + 2 <= 0x10000 ? "uint16_t" : "uint32_t";
+	auto out = OutputFile(output / (input.stem().string() + "_router.hpp"));
+	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+		<< "#pragma once\n"
+		<< "#include <algorithm>\n"
+		<< "#include <array>\n"
+		<< "#include <cstdint>\n"
+		<< "#include <string_view>\n"
+		<< '\n'
+		<< "using namespace std::literals;\n"
+		<< '\n'
+		<< "enum class RequestMethod : uint8_t {\n"
+		<< "\tPOST, PUT, GET, DELETE, PATCH,\n"
+		<< "\tHEAD, CONNECT, OPTIONS, TRACE,\n"
+		<< "\tUNKNOWN\n"
+		<< "};\n"
+		<< '\n'
+		<< "constexpr RequestMethod method_from_string(std::string_view m) noexcept {\n"
+		<< "\tswitch (m.size()) {\n"
+		<< "\tcase 3: return m == \"GET\"sv ? RequestMethod::GET : m == \"PUT\"sv ? RequestMethod::PUT : RequestMethod::UNKNOWN;\n"
+		<< "\tcase 4: return m == \"POST\"sv ? RequestMethod::POST : m == \"HEAD\"sv ? RequestMethod::HEAD : RequestMethod::UNKNOWN;\n"
+		<< "\tcase 5: return m == \"PATCH\"sv ? RequestMethod::PATCH : m == \"TRACE\"sv ? RequestMethod::TRACE : RequestMethod::UNKNOWN;\n"
+		<< "\tcase 6: return m == \"DELETE\"sv ? RequestMethod::DELETE : RequestMethod::UNKNOWN;\n"
+		<< "\tcase 7: return m == \"OPTIONS\"sv ? RequestMethod::OPTIONS : m == \"CONNECT\"sv ? RequestMethod::CONNECT : RequestMethod::UNKNOWN;\n"
+		<< "\tdefault: return RequestMethod::UNKNOWN;\n"
+		<< "\t}\n"
+		<< "}\n"
+		<< '\n'
+		<< "enum class Route : " << route_type << " {\n";
+	for (uint32_t op = 0; op < spec.operations.size(); ++op) {
+		const auto pathstr = spec.strings[spec.paths.name[spec.operations.path[op]]];
+		out << '\t' << spec.FunctionName(op) << ", // " << MethodName(spec.operations.method[op]) << ' ' << pathstr
+			<< " (" << transform_url_to_function_signature(pathstr) << ")\n";
+	}
+	out << "\tNotFound,\n"
+		<< "\tMethodNotAllowed,\n"
+		<< "};\n"
+		<< '\n'
+		<< "struct RouteMatch {\n"
+		<< "\tRoute route = Route::NotFound;\n"
+		<< "\tuint8_t num_params = 0;\n"
+		<< "\t// Path parameters in the order they appear in the template. Views into the matched target.\n"
+		<< "\tstd::array<std::string_view, " << std::max(MaxParams(root), 1) << "> params{};\n"
+		<< "};\n"
+		<< '\n'
+		<< "inline RouteMatch match_route([[maybe_unused]] RequestMethod method, std::string_view target) noexcept {\n"
+		<< "\tRouteMatch m;\n"
+		<< "\tstd::string_view path = target.substr(0, target.find_first_of(\"?#\"));\n"
+		<< "\tif (!path.empty() && path.back() == '/') {\n"
+		<< "\t\tpath.remove_suffix(1);\n"
+		<< "\t}\n"
+		<< "\t[[maybe_unused]] const size_t p0 = 0;\n";
+	std::string indent = "\t";
+	WriteNode(out, spec, root, 0, 0, indent);
+	out << "\treturn m;\n"
+		<< "}\n";
+}
@@ -0,0 +1,198 @@
+#include <filesystem>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+namespace {
+
+// Writers for the leaf types JsonTypeToCppType can produce.
+// Everything appends to a caller-owned std::string; once it has grown to fit a typical document,
+// serializing allocates nothing.
+constexpr auto primitive_serializers = R"(namespace json_detail {
+
+// Non-zero for bytes that cannot appear unescaped inside a JSON string.
+inline constexpr auto escape_table = [] {
+	std::array<char, 256> table{};
+	for (int c = 0; c < 0x20; ++c) {
+		table[c] = 'u';
+	}
+	table['"'] = '"';
+	table['\\'] = '\\';
+	table['\b'] = 'b';
+	table['\f'] = 'f';
+	table['\n'] = 'n';
+	table['\r'] = 'r';
+	table['\t'] = 't';
+	return table;
+}();
+
+inline void write_string(std::string& out, std::string_view s) {
+	out.push_back('"');
+	size_t run = 0;
+	for (size_t i = 0; i < s.size(); ++i) {
+		const char e = escape_table[static_cast<unsigned char>(s[i])];
+		if (e == 0) {
+			continue;
+		}
+		// Clean runs are copied in one go.
+		out.append(s.data() + run, i - run);
+		run = i + 1;
+		if (e == 'u') {
+			constexpr auto hex = "0123456789abcdef";
+			const char esc[] = {'\\', 'u', '0', '0', hex[(s[i] >> 4) & 0xf], hex[s[i] & 0xf]};
+			out.append(esc, sizeof(esc));
+		} else {
+			const char esc[] = {'\\', e};
+			out.append(esc, sizeof(esc));
+		}
+	}
+	out.append(s.data() + run, s.size() - run);
+	out.push_back('"');
+}
+
+template <typename T>
+inline void write_number(std::string& out, T v) {
+	char buf[32];
+	if constexpr (std::is_floating_point_v<T>) {
+		if (!std::isfinite(v)) {
+			out.append("null"sv);
+			return;
+		}
+	}
+	const auto result = std::to_chars(buf, buf + sizeof(buf), v);
+	out.append(buf, result.ptr - buf);
+}
+
+} // namespace json_detail
+
+inline void to_json(std::string& out, std::string_view v) { json_detail::write_string(out, v); }
+inline void to_json(std::string& out, bool v) { out.append(v ? "true"sv : "false"sv); }
+inline void to_json(std::string& out, int32_t v) { json_detail::write_number(out, v); }
+inline void to_json(std::string& out, int64_t v) { json_detail::write_number(out, v); }
+inline void to_json(std::string& out, float v) { json_detail::write_number(out, v); }
+inline void to_json(std::string& out, double v) { json_detail::write_number(out, v); }
+
+// Untyped schemas have no C++ representation.
+inline void to_json(std::string& out, void* const&) { out.append("null"sv); }
+
+)"sv;
+
+// Writer for std::vector of anything writable. As with the decoder, every overload its elements may need must be
+// declared before it: argument-dependent lookup does not reach the global ones for types in namespace shared_types.
+constexpr auto vector_serializer = R"(template <typename T, typename Allocator>
+void to_json(std::string& out, const std::vector<T, Allocator>& v) {
+	out.push_back('[');
+	for (size_t i = 0; i < v.size(); ++i) {
+		if (i != 0) {
+			out.push_back(',');
+		}
+		to_json(out, v[i]);
+	}
+	out.push_back(']');
+}
+
+)"sv;
+
+// Escapes text for use inside a JSON string.
+std::string JsonEscape(std::string_view text) {
+	std::string result;
+	result.reserve(text.size());
+	for (char c : text) {
+		switch (c) {
+		case '"':  result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				constexpr auto hex = "0123456789abcdef";
+				result += "\\u00";
+				result += hex[(c >> 4) & 0xf];
+				result += hex[c & 0xf];
+			} else {
+				result.push_back(c);
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+void WriteStructSerializer(std::ostream& out, const openapi::CompiledSpec& spec, openapi::SchemaId id, const std::string& qualified) {
+	const auto props = spec.schemas.properties[id];
+	out << "inline void to_json(std::string& out, const " << qualified << "& v) {\n";
+	if (props.empty()) {
+		out << "\t(void)v;\n"
+			<< "\tout.append(\"{}\"sv);\n"
+			<< "}\n\n";
+		return;
+	}
+	// Punctuation and the escaped key are folded into one literal per member, e.g. ,"name":
+	char separator = '{';
+	for (auto prop : props) {
+		const auto name = spec.strings[spec.properties.name[prop]];
+		const auto literal = separator + ('"' + JsonEscape(name) + "\":");
+		out << "\tout.append(\"" << cpp_escape(literal) << "\"sv);\n"
+			<< "\tto_json(out, v." << sanitize(name) << ");\n";
+		separator = ',';
+	}
+	out << "\tout.push_back('}');\n"
+		<< "}\n\n";
+}
+
+} // namespace
+
+// Writes JSON serializers, to_json(std::string&, const T&), for every struct in the definitions file.
+// Output is appended to the caller's buffer, so reusing one buffer across responses avoids per-field allocation.
+void serializers(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	const auto defs_header = input.stem().string() + "_defs.hpp";
+	auto out = OutputFile(output / (input.stem().string() + "_to_json.hpp"));
+	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+		<< "#pragma once\n"
+		<< "#include <array>\n"
+		<< "#include <charconv>\n"
+		<< "#include <cmath>\n"
+		<< "#include <cstdint>\n"
+		<< "#include <string>\n"
+		<< "#include <string_view>\n"
+		<< "#include <type_traits>\n"
+		<< "#include <vector>\n"
+		<< '\n'
+		<< "#include \"" << defs_header << "\"\n"
+		<< '\n'
+		<< primitive_serializers;
+
+	// Enums are written from a table of their values, already quoted and escaped.
+	spec.ForEachEnum([&out, &spec](openapi::SchemaId id, const std::string& qualified) {
+		out << "inline void to_json(std::string& out, " << qualified << " v) {\n"
+			<< "\tconstexpr std::string_view quoted[] = {";
+		for (auto i : spec.schemas.enum_[id]) {
+			const auto literal = '"' + JsonEscape(spec.strings[spec.string_lists[i]]) + '"';
+			out << (i == spec.schemas.enum_[id].first ? "" : ", ") << '"' << cpp_escape(literal) << "\"sv";
+		}
+		out << "};\n"
+			<< "\tout.append(quoted[static_cast<size_t>(v)]);\n"
+			<< "}\n\n";
+	});
+
+	std::vector<std::pair<openapi::SchemaId, std::string>> structs;
+	spec.ForEachStruct([&structs](openapi::SchemaId id, const std::string& qualified) {
+		structs.emplace_back(id, qualified);
+	});
+
+	// Declared up front, since structs may contain each other in any order, and ahead of the vector writer.
+	for (const auto& [id, qualified] : structs) {
+		out << "inline void to_json(std::string& out, const " << qualified << "& v);\n";
+	}
+	out << '\n'
+		<< vector_serializer;
+	render_sharded(out, structs.size(), [&](std::ostream& out, size_t i) {
+		WriteStructSerializer(out, spec, structs[i].first, structs[i].second);
+	});
+}
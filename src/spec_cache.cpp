@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "output.hpp"
+
+namespace openapi {
+
+namespace {
+
+constexpr char kCacheMagic[8] = {'O', 'A', 'P', 'I', 'P', 'P', 'C', '\0'};
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t columns;
+	uint64_t key;
+	uint64_t size; // Of the whole file, header included.
+};
+
+// Every table column, in file order. Both directions go through this list, so they cannot disagree.
+template <typename Spec, typename F>
+void for_each_column(Spec& spec, F&& f) {
+	f(spec.string_lists);
+	f(spec.schemas.kind);
+	f(spec.schemas.type);
+	f(spec.schemas.format);
+	f(spec.schemas.description);
+	f(spec.schemas.pattern);
+	f(spec.schemas.reference);
+	f(spec.schemas.target);
+	f(spec.schemas.items);
+	f(spec.schemas.properties);
+	f(spec.schemas.enum_);
+	f(spec.schemas.required);
+	f(spec.properties.name);
+	f(spec.properties.schema);
+	f(spec.definitions.name);
+	f(spec.definitions.type_name);
+	f(spec.definitions.schema);
+	f(spec.parameters.name);
+	f(spec.parameters.in);
+	f(spec.parameters.description);
+	f(spec.parameters.type);
+	f(spec.parameters.format);
+	f(spec.parameters.pattern);
+	f(spec.parameters.enum_);
+	f(spec.parameters.required);
+	f(spec.parameters.schema);
+	f(spec.parameters.items);
+	f(spec.responses.code);
+	f(spec.responses.description);
+	f(spec.responses.schema);
+	f(spec.operations.path);
+	f(spec.operations.method);
+	f(spec.operations.verb);
+	f(spec.operations.operation_id);
+	f(spec.operations.function_name);
+	f(spec.operations.summary);
+	f(spec.operations.description);
+	f(spec.operations.deprecated);
+	f(spec.operations.parameters);
+	f(spec.operations.responses);
+	f(spec.operations.tags);
+	f(spec.paths.name);
+	f(spec.paths.operations);
+	f(spec.shared_types.schema);
+	f(spec.shared_types.name);
+	f(spec.shared);
+}
+
+// Columns are a byte count followed by the bytes, padded so the next column starts 8-byte aligned.
+void append_column(std::string& image, const void* data, uint64_t bytes) {
+	image.append(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+	image.append(static_cast<const char*>(data), bytes);
+	image.resize((image.size() + 7) & ~size_t(7), '\0');
+}
+
+class ColumnReader {
+public:
+	ColumnReader(const char* data, size_t size)
+		: _data(data)
+		, _size(size) {}
+
+	// Returns false if the column runs past the end of the file or is not a whole number of elements.
+	bool Next(const char*& data, uint64_t& bytes, size_t element_size) {
+		if (_size - _offset < sizeof(bytes)) {
+			return false;
+		}
+		std::memcpy(&bytes, _data + _offset, sizeof(bytes));
+		_offset += sizeof(bytes);
+		if (bytes > _size - _offset || bytes % element_size != 0) {
+			return false;
+		}
+		data = _data + _offset;
+		_offset = std::min(_size, _offset + ((bytes + 7) & ~uint64_t(7)));
+		return true;
+	}
+
+private:
+	const char* _data;
+	size_t _size;
+	size_t _offset = sizeof(CacheHeader);
+};
+
+} // namespace
+
+bool CompiledSpec::SaveCache(const std::filesystem::path& file, uint64_t key) const {
+	std::string image(sizeof(CacheHeader), '\0');
+	uint32_t columns = 0;
+	for_each_column(*this, [&](const auto& column) {
+		using T = typename std::decay_t<decltype(column)>::value_type;
+		static_assert(std::is_trivially_copyable_v<T>);
+		append_column(image, column.data(), column.size() * sizeof(T));
+		++columns;
+	});
+
+	// Strings are stored back to back, with the offset of each and one past the last.
+	std::vector<uint64_t> offsets;
+	offsets.reserve(strings.size() + 1);
+	std::string text;
+	for (size_t i = 0; i < strings.size(); ++i) {
+		offsets.push_back(text.size());
+		text += strings[static_cast<StringId>(i)];
+	}
+	offsets.push_back(text.size());
+	const StringId globals[] = {host, base_path};
+	append_column(image, globals, sizeof(globals));
+	append_column(image, offsets.data(), offsets.size() * sizeof(uint64_t));
+	append_column(image, text.data(), text.size());
+	columns += 3;
+
+	CacheHeader header{};
+	std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+	header.version = kCacheVersion;
+	header.columns = columns;
+	header.key = key;
+	header.size = image.size();
+	std::memcpy(image.data(), &header, sizeof(header));
+	return replace_file(file, {image});
+}
+
+bool CompiledSpec::LoadCache(const std::filesystem::path& file, uint64_t key) {
+	auto mapping = std::make_unique<__detail::PaddedMapping>();
+	if (!mapping->Map(file.string())) {
+		return false;
+	}
+	const auto image = mapping->view();
+	CacheHeader header;
+	if (image.size() < sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&header, image.data(), sizeof(header));
+	if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.version != kCacheVersion
+		|| header.key != key || header.size != image.size()) {
+		return false;
+	}
+
+	CompiledSpec spec;
+	ColumnReader reader(image.data(), image.size());
+	bool ok = true;
+	uint32_t columns = 0;
+	for_each_column(spec, [&](auto& column) {
+		using T = typename std::decay_t<decltype(column)>::value_type;
+		const char* data = nullptr;
+		uint64_t bytes = 0;
+		if (ok && (ok = reader.Next(data, bytes, sizeof(T)))) {
+			column.resize(bytes / sizeof(T));
+			std::memcpy(column.data(), data, bytes);
+		}
+		++columns;
+	});
+	const char *globals = nullptr, *offsets = nullptr, *text = nullptr;
+	uint64_t globals_bytes = 0, offsets_bytes = 0, text_bytes = 0;
+	ok = ok && columns + 3 == header.columns
+		&& reader.Next(globals, globals_bytes, sizeof(StringId)) && globals_bytes == 2 * sizeof(StringId)
+		&& reader.Next(offsets, offsets_bytes, sizeof(uint64_t)) && offsets_bytes >= sizeof(uint64_t)
+		&& reader.Next(text, text_bytes, 1);
+	if (!ok) {
+		return false;
+	}
+
+	const size_t count = offsets_bytes / sizeof(uint64_t) - 1;
+	std::vector<std::string_view> views;
+	views.reserve(count);
+	uint64_t begin = 0, end = 0;
+	std::memcpy(&begin, offsets, sizeof(begin));
+	for (size_t i = 0; i < count; ++i, begin = end) {
+		std::memcpy(&end, offsets + (i + 1) * sizeof(uint64_t), sizeof(end));
+		if (end < begin || end > text_bytes) {
+			return false;
+		}
+		views.emplace_back(text + begin, end - begin);
+	}
+	spec.strings.Adopt(std::move(views));
+	std::memcpy(&spec.host, globals, sizeof(StringId));
+	std::memcpy(&spec.base_path, globals + sizeof(StringId), sizeof(StringId));
+	spec.pmr = pmr;
+	spec._cache = std::move(mapping);
+	*this = std::move(spec);
+	return true;
+}
+
+} // namespace openapi
@@ -1,6 +1,15 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <future>
 #include <ostream>
+#include <sstream>
+#include <string>
 #include <string_view>
+#include <vector>
+
+#include "util.hpp"
 
 using namespace std::literals;
 
@@ -29,20 +38,34 @@ bool compare_ignore_case(std::string_view l, std::string_view r) noexcept {
 }
 
 void sanitize(std::string& input) {
-	// Replace characters with underscore.
+	// Anything that cannot appear in an identifier becomes an underscore.
 	std::replace_if(input.begin(), input.end(), [](char c) -> bool {
-		constexpr auto chars = std::array{'/', '-', '.', ':', '+'};
-		return std::any_of(chars.begin(), chars.end(), [c](char d) { return c == d; });
+		return !std::isalnum(static_cast<unsigned char>(c)) && c != '_';
 	}, '_');
+	if (input.empty()) {
+		input = "_";
+	}
 
 	// Reserved keywords in C++.
-	constexpr auto reserved = std::array{"operator"sv, "long"sv, "short"sv};
+	constexpr auto reserved = std::array{
+		"alignas"sv, "alignof"sv, "and"sv, "and_eq"sv, "asm"sv, "auto"sv, "bitand"sv, "bitor"sv, "bool"sv, "break"sv,
+		"case"sv, "catch"sv, "char"sv, "char8_t"sv, "char16_t"sv, "char32_t"sv, "class"sv, "compl"sv, "concept"sv,
+		"const"sv, "consteval"sv, "constexpr"sv, "constinit"sv, "const_cast"sv, "continue"sv, "co_await"sv,
+		"co_return"sv, "co_yield"sv, "decltype"sv, "default"sv, "delete"sv, "do"sv, "double"sv, "dynamic_cast"sv,
+		"else"sv, "enum"sv, "explicit"sv, "export"sv, "extern"sv, "false"sv, "float"sv, "for"sv, "friend"sv, "goto"sv,
+		"if"sv, "inline"sv, "int"sv, "long"sv, "mutable"sv, "namespace"sv, "new"sv, "noexcept"sv, "not"sv, "not_eq"sv,
+		"nullptr"sv, "operator"sv, "or"sv, "or_eq"sv, "private"sv, "protected"sv, "public"sv, "register"sv,
+		"reinterpret_cast"sv, "requires"sv, "return"sv, "short"sv, "signed"sv, "sizeof"sv, "static"sv,
+		"static_assert"sv, "static_cast"sv, "struct"sv, "switch"sv, "template"sv, "this"sv, "thread_local"sv,
+		"throw"sv, "true"sv, "try"sv, "typedef"sv, "typeid"sv, "typename"sv, "union"sv, "unsigned"sv, "using"sv,
+		"virtual"sv, "void"sv, "volatile"sv, "wchar_t"sv, "while"sv, "xor"sv, "xor_eq"sv,
+	};
 	if (std::any_of(reserved.begin(), reserved.end(), [&input] (const std::string_view& kw) { return input == kw;})) {
 		input.push_back('_');
 	}
 
 	// Names cannot start with a number.
-	if (std::isdigit(input[0])) {
+	if (std::isdigit(static_cast<unsigned char>(input[0]))) {
 		input.insert(0, 1, '_');
 	}
 }
@@ -64,19 +87,124 @@ void write_multiline_comment(std::ostream& out, std::string_view comment, std::s
 	}
 }
 
-// TODO
+// Turns the parameters of a path template into a parameter list, e.g. "/a/{x}/b/:y" -> "std::string_view x, std::string_view y".
+// Both {brace} and :colon style parameters are recognized.
 std::string transform_url_to_function_signature(std::string_view url) {
 	std::string result;
 	result.reserve(url.size());
-	// Count number of parameters by counting brace pairs and single colons.
-	int num_params = 0;
-	std::vector<std::string> parameters;
 	while (!url.empty()) {
-		auto brace = url.find_first_of('{');
-		if (brace != std::string_view::npos) {
+		std::string_view name;
+		auto brace = url.find('{');
+		auto colon = url.find(':');
+		if (brace != std::string_view::npos && brace < colon) {
+			auto close = url.find('}', brace);
+			if (close == std::string_view::npos) {
+				break;
+			}
+			name = url.substr(brace + 1, close - brace - 1);
+			url.remove_prefix(close + 1);
+		} else if (colon != std::string_view::npos) {
+			auto end = url.find('/', colon);
+			name = url.substr(colon + 1, end == std::string_view::npos ? std::string_view::npos : end - colon - 1);
+			url.remove_prefix(end == std::string_view::npos ? url.size() : end);
+		} else {
+			break;
+		}
+		if (!result.empty()) {
+			result += ", ";
+		}
+		result += "std::string_view ";
+		result += sanitize(name);
+	}
+	return result;
+}
 
+std::string cpp_escape(std::string_view text) {
+	std::string result;
+	result.reserve(text.size());
+	for (char c : text) {
+		switch (c) {
+		case '"':  result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				// Octal escapes, unlike \x, cannot swallow the characters that follow.
+				result += '\\';
+				result += static_cast<char>('0' + ((c >> 6) & 7));
+				result += static_cast<char>('0' + ((c >> 3) & 7));
+				result += static_cast<char>('0' + (c & 7));
+			} else {
+				result.push_back(c);
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+std::string json_pointer_escape(std::string_view token) {
+	std::string result;
+	result.reserve(token.size());
+	for (char c : token) {
+		switch (c) {
+		case '~': result += "~0"; break;
+		case '/': result += "~1"; break;
+		default: result.push_back(c); break;
 		}
-		auto colon = url.find_first_of(':');
 	}
 	return result;
-}
\ No newline at end of file
+}
+
+static std::atomic<unsigned> g_parallelism = 1;
+
+void set_parallelism(unsigned jobs) {
+	g_parallelism = std::max(jobs, 1u);
+}
+
+unsigned parallelism() {
+	return g_parallelism;
+}
+
+void render_sharded(std::ostream& out, size_t count, const std::function<void(std::ostream&, size_t)>& render) {
+	// A few shards per thread keeps threads busy when items differ a lot in size.
+	const size_t shards = std::min<size_t>(count, size_t(parallelism()) * 4);
+	if (shards <= 1 || parallelism() == 1) {
+		for (size_t i = 0; i < count; ++i) {
+			render(out, i);
+		}
+		return;
+	}
+	std::vector<std::ostringstream> buffers(shards);
+	std::atomic<size_t> next = 0;
+	auto worker = [&] {
+		for (size_t shard = next++; shard < shards; shard = next++) {
+			const size_t first = count * shard / shards;
+			const size_t last = count * (shard + 1) / shards;
+			for (size_t i = first; i < last; ++i) {
+				render(buffers[shard], i);
+			}
+		}
+	};
+	std::vector<std::future<void>> workers;
+	for (unsigned t = 1; t < std::min<size_t>(parallelism(), shards); ++t) {
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (auto& w : workers) {
+		w.get();
+	}
+	for (auto& buffer : buffers) {
+		out << buffer.view();
+	}
+}
+
+uint64_t fnv1a(std::string_view data, uint64_t hash) noexcept {
+	for (unsigned char c : data) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,161 @@
+#include <filesystem>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "output.hpp"
+#include "pattern_dfa.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+namespace {
+
+// Emits the automaton as constexpr tables and a loop that does one class lookup and one transition per byte.
+void WritePatternMatcher(std::ostream& out, const PatternDfa& dfa, std::string_view pattern, openapi::StringId id) {
+	const auto state_type = dfa.num_states() <= 256 ? "uint8_t"sv : "uint16_t"sv;
+	out << "// Matches \"" << cpp_escape(pattern) << "\"\n"
+		<< "inline bool pattern_" << id << "(std::string_view s) noexcept {\n"
+		<< "\tstatic constexpr uint8_t classes[256] = {";
+	for (unsigned c = 0; c < 256; ++c) {
+		out << (c % 32 == 0 ? "\n\t\t" : " ") << unsigned(dfa.byte_class(static_cast<unsigned char>(c))) << ',';
+	}
+	out << "\n\t};\n"
+		<< "\tstatic constexpr " << state_type << " next[" << dfa.num_states() << "][" << dfa.num_classes() << "] = {\n";
+	for (uint32_t s = 0; s < dfa.num_states(); ++s) {
+		out << "\t\t{";
+		for (size_t cls = 0; cls < dfa.num_classes(); ++cls) {
+			out << (cls == 0 ? "" : ", ") << dfa.next(s, static_cast<uint8_t>(cls));
+		}
+		out << "},\n";
+	}
+	out << "\t};\n"
+		<< "\tstatic constexpr bool accept[" << dfa.num_states() << "] = {";
+	for (uint32_t s = 0; s < dfa.num_states(); ++s) {
+		out << (s == 0 ? "" : ", ") << (dfa.accepting(s) ? "true" : "false");
+	}
+	out << "};\n"
+		<< "\tunsigned state = 0;\n"
+		<< "\tfor (unsigned char c : s) {\n"
+		<< "\t\tstate = next[state][classes[c]];\n";
+	if (dfa.dead_state() != PatternDfa::kNoState) {
+		out << "\t\tif (state == " << dfa.dead_state() << ") {\n"
+			<< "\t\t\treturn false;\n"
+			<< "\t\t}\n";
+	}
+	if (dfa.accept_state() != PatternDfa::kNoState) {
+		out << "\t\tif (state == " << dfa.accept_state() << ") {\n"
+			<< "\t\t\treturn true;\n"
+			<< "\t\t}\n";
+	}
+	out << "\t}\n"
+		<< "\treturn accept[state];\n"
+		<< "}\n\n";
+}
+
+// Body of a string check: the enum as a switch on length, then the pattern.
+void WriteStringCheck(std::ostream& out, const openapi::CompiledSpec& spec, openapi::StringId pattern, openapi::Range enum_,
+	const std::set<openapi::StringId>& compiled) {
+	if (!enum_.empty()) {
+		std::map<size_t, std::vector<std::string_view>> by_length;
+		for (auto i : enum_) {
+			const auto value = spec.strings[spec.string_lists[i]];
+			by_length[value.size()].push_back(value);
+		}
+		out << "\tswitch (s.size()) {\n";
+		for (const auto& [len, values] : by_length) {
+			out << "\tcase " << len << ":\n"
+				<< "\t\tif (";
+			for (size_t i = 0; i < values.size(); ++i) {
+				out << (i == 0 ? "" : " || ") << "s == \"" << cpp_escape(values[i]) << "\"sv";
+			}
+			out << ") {\n"
+				<< "\t\t\tbreak;\n"
+				<< "\t\t}\n"
+				<< "\t\treturn false;\n";
+		}
+		out << "\tdefault:\n"
+			<< "\t\treturn false;\n"
+			<< "\t}\n";
+	}
+	if (pattern != 0 && compiled.count(pattern)) {
+		out << "\treturn pattern_" << pattern << "(s);\n";
+		return;
+	}
+	if (pattern != 0) {
+		out << "\t// \"" << cpp_escape(spec.strings[pattern]) << "\" cannot be compiled to a DFA and is not checked.\n";
+	}
+	if (enum_.empty()) {
+		out << "\t(void)s;\n";
+	}
+	out << "\treturn true;\n";
+}
+
+} // namespace
+
+// Name of the matcher written for a constrained string schema (see CompiledSpec::IsConstrainedString).
+std::string matcher_name(openapi::SchemaId id) {
+	return "validation::schema_" + std::to_string(id);
+}
+
+// Writes string validators. Every pattern in the spec is compiled to a DFA here, at generation time,
+// and enums become a switch on length followed by a few comparisons, so validation needs no regex engine.
+// Schema validators are used by the generated from_json, parameter validators by the generated server.
+void validators(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	auto out = OutputFile(output / (input.stem().string() + "_validate.hpp"));
+	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+		<< "#pragma once\n"
+		<< "#include <cstdint>\n"
+		<< "#include <string_view>\n"
+		<< '\n'
+		<< "using namespace std::literals;\n"
+		<< '\n'
+		<< "namespace validation {\n"
+		<< '\n';
+
+	std::set<openapi::StringId> patterns, compiled;
+	for (openapi::SchemaId id = 0; id < spec.schemas.size(); ++id) {
+		if (spec.IsConstrainedString(id) && spec.schemas.pattern[id] != 0) {
+			patterns.insert(spec.schemas.pattern[id]);
+		}
+	}
+	for (uint32_t param = 0; param < spec.parameters.size(); ++param) {
+		if (spec.IsConstrainedParameter(param) && spec.parameters.pattern[param] != 0) {
+			patterns.insert(spec.parameters.pattern[param]);
+		}
+	}
+	for (auto pattern : patterns) {
+		PatternDfa dfa;
+		if (dfa.Compile(spec.strings[pattern])) {
+			WritePatternMatcher(out, dfa, spec.strings[pattern], pattern);
+			compiled.insert(pattern);
+		}
+	}
+
+	for (openapi::SchemaId id = 0; id < spec.schemas.size(); ++id) {
+		if (!spec.IsConstrainedString(id)) {
+			continue;
+		}
+		out << "inline bool schema_" << id << "(std::string_view s) noexcept {\n";
+		WriteStringCheck(out, spec, spec.schemas.pattern[id], spec.schemas.enum_[id], compiled);
+		out << "}\n\n";
+	}
+	out << "} // namespace validation\n";
+
+	for (uint32_t op = 0; op < spec.operations.size(); ++op) {
+		for (auto param : spec.operations.parameters[op]) {
+			if (!spec.IsConstrainedParameter(param)) {
+				continue;
+			}
+			const auto name = spec.strings[spec.parameters.name[param]];
+			out << '\n'
+				<< "// " << spec.strings[spec.parameters.in[param]] << " parameter " << name << " of " << spec.FunctionName(op) << '\n'
+				<< "inline bool " << spec.ParameterValidatorName(op, param) << "(std::string_view s) noexcept {\n"
+				<< "\tusing namespace validation;\n";
+			WriteStringCheck(out, spec, spec.parameters.pattern[param], spec.parameters.enum_[param], compiled);
+			out << "}\n";
+		}
+	}
+}
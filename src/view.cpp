@@ -0,0 +1,307 @@
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "compiled_spec.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+using namespace std::literals;
+
+namespace {
+
+// Decoders for the leaf types of a view, and the lazy array itself. Enum decoders are inserted between the two,
+// since Array<T> looks from_dom up where it is defined for every T that is not a view struct.
+constexpr auto primitive_decoders = R"(inline simdjson::error_code from_dom(simdjson::dom::element e, std::string_view& out) {
+	return e.get_string().get(out);
+}
+
+inline simdjson::error_code from_dom(simdjson::dom::element e, bool& out) {
+	return e.get_bool().get(out);
+}
+
+inline simdjson::error_code from_dom(simdjson::dom::element e, int64_t& out) {
+	return e.get_int64().get(out);
+}
+
+inline simdjson::error_code from_dom(simdjson::dom::element e, int32_t& out) {
+	int64_t i = 0;
+	auto err = e.get_int64().get(i);
+	if (!err && (i < INT32_MIN || i > INT32_MAX)) {
+		return simdjson::NUMBER_OUT_OF_RANGE;
+	}
+	out = static_cast<int32_t>(i);
+	return err;
+}
+
+inline simdjson::error_code from_dom(simdjson::dom::element e, double& out) {
+	return e.get_double().get(out);
+}
+
+inline simdjson::error_code from_dom(simdjson::dom::element e, float& out) {
+	double d = 0;
+	auto err = e.get_double().get(d);
+	out = static_cast<float>(d);
+	return err;
+}
+
+// Untyped schemas are left as they are in the document.
+inline simdjson::error_code from_dom(simdjson::dom::element e, simdjson::dom::element& out) {
+	out = e;
+	return simdjson::SUCCESS;
+}
+
+)"sv;
+
+constexpr auto array_view = R"(// A JSON array whose elements are decoded when they are dereferenced, each into a new T. Holding one costs no more
+// than the DOM array it refers to. An element that does not decode comes out value-initialized; check() tells.
+template <typename T>
+class Array {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = T;
+
+		iterator() = default;
+		explicit iterator(simdjson::dom::array::iterator it)
+			: _it(it) {}
+		T operator*() const {
+			T value{};
+			(void)from_dom(*_it, value);
+			return value;
+		}
+		iterator& operator++() { ++_it; return *this; }
+		iterator operator++(int) { auto old = *this; ++_it; return old; }
+		bool operator==(const iterator& other) const { return _it == other._it; }
+		bool operator!=(const iterator& other) const { return _it != other._it; }
+
+	private:
+		simdjson::dom::array::iterator _it;
+	};
+
+	Array() = default;
+	explicit Array(simdjson::dom::array array)
+		: _array(array)
+		, _present(true) {}
+
+	// An absent array is empty.
+	iterator begin() const { return _present ? iterator(_array.begin()) : iterator(); }
+	iterator end() const { return _present ? iterator(_array.end()) : iterator(); }
+	size_t size() const { return _present ? _array.size() : 0; }
+	bool empty() const { return size() == 0; }
+
+	// The array in the document, e.g. to pass it on without decoding it.
+	simdjson::dom::array json() const { return _array; }
+
+	// Decodes every element, for callers that need to know the whole array is well-formed.
+	simdjson::error_code check() const {
+		if (!_present) {
+			return simdjson::SUCCESS;
+		}
+		for (auto element : _array) {
+			T value{};
+			SIMDJSON_TRY(from_dom(element, value));
+		}
+		return simdjson::SUCCESS;
+	}
+
+private:
+	simdjson::dom::array _array;
+	bool _present = false;
+};
+
+template <typename T>
+simdjson::error_code from_dom(simdjson::dom::element e, Array<T>& out) {
+	simdjson::dom::array arr;
+	SIMDJSON_TRY(e.get_array().get(arr));
+	out = Array<T>(arr);
+	return simdjson::SUCCESS;
+}
+
+// Parses a whole document, e.g. a request body, and decodes its view into out. The views refer to memory owned
+// by the parser: they stay valid until the parser parses another document or is destroyed.
+template <typename T>
+simdjson::error_code parse_view(simdjson::dom::parser& parser, simdjson::padded_string_view json, T& out) {
+	simdjson::dom::element root;
+	SIMDJSON_TRY(parser.parse(json.data(), json.size(), false).get(root));
+	return from_dom(root, out);
+}
+
+} // namespace json_view
+
+)"sv;
+
+// C++ type of a schema in a view. As CompiledSpec::CppType, with strings as views into the document, arrays
+// decoded lazily, and untyped values left as DOM elements.
+std::string ViewType(const openapi::CompiledSpec& spec, openapi::SchemaId id, std::string_view nested_name) {
+	if (id == openapi::npos) {
+		return "simdjson::dom::element";
+	}
+	switch (spec.schemas.kind[id]) {
+	case openapi::JsonType::Reference: return std::string(spec.ReferenceTypeName(id));
+	case openapi::JsonType::Object:    return std::string(nested_name);
+	case openapi::JsonType::Array:     return "json_view::Array<" + ViewType(spec, spec.schemas.items[id], nested_name) + '>';
+	default: break;
+	}
+	if (spec.IsEnum(id)) {
+		return std::string(nested_name);
+	}
+	const auto type = openapi::JsonTypeToCppType(spec.strings[spec.schemas.type[id]], spec.strings[spec.schemas.format[id]]);
+	return type == "std::string" ? "std::string_view" : type == "void*" ? "simdjson::dom::element" : std::string(type);
+}
+
+void WriteViewStruct(std::ostream& out, const openapi::CompiledSpec& spec, openapi::SchemaId id, std::string_view name, const std::string& owning, std::string& indent);
+
+// Declares the nested view type a property needs, as CompiledSpec::PrintSchema declares the owning one.
+// Enums are the owning enum classes: decoding one copies nothing.
+void WriteNestedViews(std::ostream& out, const openapi::CompiledSpec& spec, openapi::SchemaId id, std::string_view name, const std::string& owning, std::string& indent) {
+	if (id == openapi::npos) {
+		return;
+	}
+	if (spec.schemas.kind[id] == openapi::JsonType::Array) {
+		WriteNestedViews(out, spec, spec.schemas.items[id], name, owning, indent);
+	} else if (spec.shared[id] != openapi::npos) {
+		out << indent << "using " << name << " = shared_types::" << spec.strings[spec.shared_types.name[spec.shared[id]]] << ";\n";
+	} else if (spec.IsEnum(id)) {
+		out << indent << "using " << name << " = " << owning << ";\n";
+	} else if (spec.schemas.kind[id] == openapi::JsonType::Object) {
+		WriteViewStruct(out, spec, id, name, owning, indent);
+	}
+}
+
+// A view struct and its decoder. The decoder is a hidden friend, so Array<T> finds it by argument-dependent lookup
+// wherever the struct is nested.
+void WriteViewStruct(std::ostream& out, const openapi::CompiledSpec& spec, openapi::SchemaId id, std::string_view name, const std::string& owning, std::string& indent) {
+	std::map<size_t, std::vector<uint32_t>> by_length;
+	out << indent << "struct " << name << " {\n";
+	indent.push_back('\t');
+	for (auto prop : spec.schemas.properties[id]) {
+		const auto propname = spec.strings[spec.properties.name[prop]];
+		const auto propschema = spec.properties.schema[prop];
+		const auto nested = openapi::CompiledSpec::NestedTypeName(propname);
+		WriteNestedViews(out, spec, propschema, nested, owning + "::" + nested, indent);
+		out << indent << ViewType(spec, propschema, nested) << ' ' << sanitize(propname) << "{};\n";
+		by_length[propname.size()].push_back(prop);
+	}
+
+	out << '\n'
+		<< indent << "friend simdjson::error_code from_dom(simdjson::dom::element e, " << name << "& out) {\n"
+		<< indent << "\tsimdjson::dom::object obj;\n"
+		<< indent << "\tSIMDJSON_TRY(e.get_object().get(obj));\n";
+	if (by_length.empty()) {
+		out << indent << "\t(void)out;\n";
+	} else {
+		out << indent << "\tfor (auto field : obj) {\n"
+			<< indent << "\t\tif (field.value.is_null()) {\n"
+			<< indent << "\t\t\tcontinue;\n"
+			<< indent << "\t\t}\n"
+			<< indent << "\t\tswitch (field.key.size()) {\n";
+		for (const auto& [len, props] : by_length) {
+			out << indent << "\t\tcase " << len << ":\n";
+			for (auto prop : props) {
+				const auto propname = spec.strings[spec.properties.name[prop]];
+				out << indent << "\t\t\tif (field.key == \"" << cpp_escape(propname) << "\"sv) {\n"
+					<< indent << "\t\t\t\tSIMDJSON_TRY(from_dom(field.value, out." << sanitize(propname) << "));\n"
+					<< indent << "\t\t\t\tcontinue;\n"
+					<< indent << "\t\t\t}\n";
+			}
+			out << indent << "\t\t\tbreak;\n";
+		}
+		out << indent << "\t\tdefault: break;\n"
+			<< indent << "\t\t}\n"
+			<< indent << "\t}\n";
+	}
+	out << indent << "\treturn simdjson::SUCCESS;\n"
+		<< indent << "}\n";
+	indent.pop_back();
+	out << indent << "};\n";
+}
+
+} // namespace
+
+// Writes read-only views of every definition, in namespace views and under the same names as the owning types.
+// A view is decoded from a simdjson DOM without copying: strings are std::string_view into the parser's buffers,
+// and arrays are json_view::Array<T>, which decode an element only when it is dereferenced. Values are checked
+// against their JSON type but not against patterns or required members; use from_json for that.
+void views(const fs::path& input, const fs::path& output, const openapi::CompiledSpec& spec) {
+	const auto defs_header = input.stem().string() + "_defs.hpp";
+	auto out = OutputFile(output / (input.stem().string() + "_views.hpp"));
+	out << "// DO NOT EDIT. Automatically generated from " << input.filename().string() << '\n'
+		<< "#pragma once\n"
+		<< "#include <cstddef>\n"
+		<< "#include <cstdint>\n"
+		<< "#include <iterator>\n"
+		<< "#include <string_view>\n"
+		<< '\n'
+		<< "#include <simdjson.h>\n"
+		<< '\n'
+		<< "#include \"" << defs_header << "\"\n"
+		<< '\n'
+		<< "namespace json_view {\n"
+		<< '\n'
+		<< primitive_decoders;
+
+	// Enums decode through the constexpr tables in the definitions header.
+	spec.ForEachEnum([&out](openapi::SchemaId, const std::string& qualified) {
+		out << "inline simdjson::error_code from_dom(simdjson::dom::element e, ::" << qualified << "& out) {\n"
+			<< "\tstd::string_view sv;\n"
+			<< "\tSIMDJSON_TRY(e.get_string().get(sv));\n"
+			<< "\treturn enum_from_string(sv, out) ? simdjson::SUCCESS : simdjson::INCORRECT_TYPE;\n"
+			<< "}\n\n";
+	});
+	out << array_view;
+
+	out << "namespace views {\n"
+		<< '\n'
+		<< "using json_view::from_dom;\n"
+		<< '\n';
+	std::string indent;
+	if (spec.shared_types.size() != 0) {
+		out << "namespace shared_types {\n"
+			<< '\n';
+		for (size_t i = 0; i < spec.shared_types.size(); ++i) {
+			const auto name = spec.strings[spec.shared_types.name[i]];
+			const auto id = spec.shared_types.schema[i];
+			if (spec.IsEnum(id)) {
+				out << "using " << name << " = ::shared_types::" << name << ";\n";
+			} else {
+				WriteViewStruct(out, spec, id, name, "::shared_types::" + std::string(name), indent);
+			}
+			out << '\n';
+		}
+		out << "} // namespace shared_types\n"
+			<< '\n';
+	}
+
+	// Same order as the definitions header; only arrays may refer to a struct declared further down.
+	const auto order = spec.DefinitionOrder();
+	for (auto def : order) {
+		if (spec.schemas.kind[spec.definitions.schema[def]] == openapi::JsonType::Object) {
+			out << "struct " << spec.strings[spec.definitions.type_name[def]] << ";\n";
+		}
+	}
+	out << '\n';
+	render_sharded(out, order.size(), [&spec, &order](std::ostream& out, size_t i) {
+		const auto id = spec.definitions.schema[order[i]];
+		const auto name = spec.strings[spec.definitions.type_name[order[i]]];
+		const auto owning = "::" + std::string(name);
+		std::string indent;
+		if (spec.schemas.kind[id] == openapi::JsonType::Object) {
+			WriteViewStruct(out, spec, id, name, owning, indent);
+		} else if (spec.IsEnum(id)) {
+			out << "using " << name << " = " << owning << ";\n";
+		} else {
+			const auto nested = openapi::CompiledSpec::NestedTypeName(spec.strings[spec.definitions.type_name[order[i]]]);
+			WriteNestedViews(out, spec, id, nested, "::" + nested, indent);
+			out << "using " << name << " = " << ViewType(spec, id, nested) << ";\n";
+		}
+		out << '\n';
+	});
+	out << "} // namespace views\n";
+}
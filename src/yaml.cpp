@@ -0,0 +1,1077 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "yaml.hpp"
+
+namespace openapi {
+
+namespace {
+
+// Builds a tape in simdjson's format: one 64-bit word per value, the type character in the top byte. Objects and
+// arrays are a pair of words that point at each other, the opening one also holding the element count; numbers
+// take a second word; strings point into the string buffer, where they are stored as length, bytes and NUL.
+class TapeWriter final {
+public:
+	size_t size() const noexcept { return _tape.size(); }
+
+	size_t Open() {
+		_tape.push_back(0);
+		return _tape.size() - 1;
+	}
+	void Close(size_t open, char type, size_t count) {
+		_Word(type == '{' ? '}' : ']', open);
+		_tape[open] = _Make(type, (std::min<uint64_t>(count, kCountMask) << 32) | _tape.size());
+	}
+	void String(std::string_view s) {
+		_Word('"', _strings.size());
+		const auto len = static_cast<uint32_t>(s.size());
+		_strings.append(reinterpret_cast<const char*>(&len), sizeof(len));
+		_strings.append(s);
+		_strings.push_back('\0');
+	}
+	void Int64(int64_t value) {
+		_Word('l', 0);
+		_tape.push_back(std::bit_cast<uint64_t>(value));
+	}
+	void Uint64(uint64_t value) {
+		_Word('u', 0);
+		_tape.push_back(value);
+	}
+	void Double(double value) {
+		_Word('d', 0);
+		_tape.push_back(std::bit_cast<uint64_t>(value));
+	}
+	void Literal(char type) { _Word(type, 0); } // 't', 'f' or 'n'.
+
+	// Appends a copy of the values in [begin, end), for an alias. Strings are shared with the original.
+	void Copy(size_t begin, size_t end) {
+		const uint64_t delta = _tape.size() - begin;
+		for (size_t i = begin; i < end; ++i) {
+			const uint64_t word = _tape[i];
+			switch (static_cast<char>(word >> 56)) {
+			case '{':
+			case '[':
+				_tape.push_back((word & ~uint64_t(0xFFFFFFFF)) | (uint32_t(word) + delta));
+				break;
+			case '}':
+			case ']':
+				_tape.push_back(word + delta);
+				break;
+			case 'l':
+			case 'u':
+			case 'd':
+				_tape.push_back(word);
+				_tape.push_back(_tape[++i]);
+				break;
+			default:
+				_tape.push_back(word);
+				break;
+			}
+		}
+	}
+
+	// The root words wrap the single top-level value. The first holds the length of the tape.
+	void BeginRoot() { _tape.push_back(0); }
+	void EndRoot() {
+		_Word('r', 0);
+		_tape[0] = _Make('r', _tape.size());
+	}
+
+	bool Finish(simdjson::dom::document& doc) const {
+		const size_t capacity = std::max(_tape.size(), _strings.size());
+		if (doc.capacity() < capacity && doc.allocate(capacity) != simdjson::SUCCESS) {
+			return false;
+		}
+		std::memcpy(doc.tape.get(), _tape.data(), _tape.size() * sizeof(uint64_t));
+		std::memcpy(doc.string_buf.get(), _strings.data(), _strings.size());
+		return true;
+	}
+
+private:
+	static constexpr uint64_t kCountMask = 0xFFFFFF;
+	static uint64_t _Make(char type, uint64_t payload) { return (uint64_t(uint8_t(type)) << 56) | payload; }
+	void _Word(char type, uint64_t payload) { _tape.push_back(_Make(type, payload)); }
+
+	std::vector<uint64_t> _tape;
+	std::string _strings;
+};
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t'; }
+inline bool is_break(char c) { return c == '\n' || c == '\r'; }
+inline bool is_flow_indicator(char c) { return c == ',' || c == '[' || c == ']' || c == '{' || c == '}'; }
+
+void append_utf8(std::string& out, uint32_t cp) {
+	if (cp < 0x80) {
+		out.push_back(static_cast<char>(cp));
+	} else if (cp < 0x800) {
+		out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+		out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+	} else if (cp < 0x10000) {
+		out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+		out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+	} else {
+		out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+		out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+	}
+}
+
+// True if text is a float of the core schema: [-+]?(\.[0-9]+|[0-9]+(\.[0-9]*)?)([eE][-+]?[0-9]+)?
+bool is_core_float(std::string_view text) {
+	size_t i = 0;
+	const auto digits = [&] {
+		const size_t start = i;
+		while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+			++i;
+		}
+		return i - start;
+	};
+	if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+		++i;
+	}
+	const size_t whole = digits();
+	size_t fraction = 0;
+	if (i < text.size() && text[i] == '.') {
+		++i;
+		fraction = digits();
+	}
+	if (whole == 0 && fraction == 0) {
+		return false;
+	}
+	if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+		++i;
+		if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+			++i;
+		}
+		if (digits() == 0) {
+			return false;
+		}
+	}
+	return i == text.size();
+}
+
+// Recursive descent over the block structure, which YAML expresses through indentation.
+// Block-context parsers return with the cursor on the first content character of the next line that holds any
+// (or with _eof set), so their caller can compare its column against its own. Flow-context parsers stop right
+// after the value. All return false on a syntax error, with _error set.
+class YamlParser final {
+public:
+	YamlParser(std::string_view text, TapeWriter& out)
+		: _text(text)
+		, _out(out) {}
+
+	bool Parse();
+	std::string Error() const { return "line " + std::to_string(_error_line) + ": " + _error; }
+
+private:
+	static constexpr int kMaxDepth = 1024;
+
+	struct Cursor {
+		size_t pos, line_start, line;
+	};
+
+	std::string_view _text;
+	TapeWriter& _out;
+	size_t _pos = 0;
+	size_t _line_start = 0;
+	size_t _line = 1;
+	bool _eof = false;
+	int _depth = 0;
+	std::string _error;
+	size_t _error_line = 0;
+	std::unordered_map<std::string, std::pair<size_t, size_t>> _anchors; // Tape range of each anchored value.
+	std::string _folded; // A flow scalar that spans lines, until it has been written.
+
+	bool _Fail(std::string message) {
+		if (_error.empty()) {
+			_error = std::move(message);
+			_error_line = _line;
+		}
+		return false;
+	}
+
+	Cursor _Save() const { return {_pos, _line_start, _line}; }
+	void _Restore(const Cursor& c) {
+		_pos = c.pos;
+		_line_start = c.line_start;
+		_line = c.line;
+	}
+
+	char _Peek(size_t ahead = 0) const { return _pos + ahead < _text.size() ? _text[_pos + ahead] : '\0'; }
+	int _Column() const { return static_cast<int>(_pos - _line_start); }
+
+	// Index of the '\n' ending the line that contains from, or the end of the text. memchr is vectorized.
+	size_t _LineEnd(size_t from) const {
+		const void* nl = std::memchr(_text.data() + from, '\n', _text.size() - from);
+		return nl ? static_cast<size_t>(static_cast<const char*>(nl) - _text.data()) : _text.size();
+	}
+
+	// Index of a comment on [from, end): a '#' at the start or after a blank. end if there is none.
+	size_t _CommentStart(size_t from, size_t end) const {
+		for (size_t p = from; p < end;) {
+			const void* hash = std::memchr(_text.data() + p, '#', end - p);
+			if (!hash) {
+				break;
+			}
+			const size_t at = static_cast<size_t>(static_cast<const char*>(hash) - _text.data());
+			if (at == _line_start || is_blank(_text[at - 1])) {
+				return at;
+			}
+			p = at + 1;
+		}
+		return end;
+	}
+
+	void _SkipBlanks() {
+		while (_pos < _text.size() && is_blank(_text[_pos])) {
+			++_pos;
+		}
+	}
+
+	bool _AtLineEnd() const { return _pos >= _text.size() || is_break(_text[_pos]) || _text[_pos] == '#'; }
+
+	// Moves to the start of the next line. False at the end of the text.
+	bool _NextLine() {
+		const size_t end = _LineEnd(_pos);
+		if (end >= _text.size()) {
+			_pos = _text.size();
+			return false;
+		}
+		_pos = _line_start = end + 1;
+		++_line;
+		return true;
+	}
+
+	// From the start of the current line, skips blank and comment-only lines. Stops on the first content character,
+	// or sets _eof at the end of the text or of the document ("---" or "...").
+	bool _SkipToContent() {
+		_pos = _line_start;
+		do {
+			while (_pos < _text.size() && _text[_pos] == ' ') {
+				++_pos;
+			}
+			if (_pos < _text.size() && _text[_pos] == '\t') {
+				_SkipBlanks();
+				if (!_AtLineEnd()) {
+					return _Fail("tab in indentation");
+				}
+			}
+			if (!_AtLineEnd()) {
+				const auto rest = _text.substr(_line_start);
+				const bool marker = (rest.starts_with("---") || rest.starts_with("..."))
+					&& (rest.size() == 3 || is_blank(rest[3]) || is_break(rest[3]));
+				_eof = marker;
+				return true;
+			}
+		} while (_NextLine());
+		_eof = true;
+		return true;
+	}
+
+	// Checks that nothing but a comment follows on this line, then moves to the next content.
+	bool _NextContent() {
+		_SkipBlanks();
+		if (!_AtLineEnd()) {
+			return _Fail("unexpected text after a value");
+		}
+		if (!_NextLine()) {
+			_eof = true;
+			return true;
+		}
+		return _SkipToContent();
+	}
+
+	bool _IsSequenceEntry() const {
+		return _Peek() == '-' && (_pos + 1 >= _text.size() || is_blank(_Peek(1)) || is_break(_Peek(1)));
+	}
+
+	// Finds the ':' ending a quoted string that starts at p, on the same line. npos if p is not a quoted key.
+	size_t _QuotedKeyEnd(size_t p, size_t end) const {
+		const char quote = _text[p];
+		for (++p; p < end; ++p) {
+			if (_text[p] == '\\' && quote == '"') {
+				++p;
+			} else if (_text[p] == quote) {
+				if (quote == '\'' && p + 1 < end && _text[p + 1] == '\'') {
+					++p;
+					continue;
+				}
+				for (++p; p < end && is_blank(_text[p]); ++p) {
+				}
+				return p < end && _text[p] == ':' && (p + 1 >= end || is_blank(_text[p + 1]) || is_break(_text[p + 1])) ? p : std::string_view::npos;
+			}
+		}
+		return std::string_view::npos;
+	}
+
+	// Finds the ':' that makes the rest of the line a "key: value" pair. npos if it is not one.
+	size_t _KeyEnd() const {
+		const size_t end = _LineEnd(_pos);
+		const char c = _Peek();
+		if (c == '"' || c == '\'') {
+			return _QuotedKeyEnd(_pos, end);
+		}
+		if (c == '[' || c == '{' || c == '|' || c == '>' || c == '*' || c == '&' || c == '!' || c == '#') {
+			return std::string_view::npos;
+		}
+		const size_t comment = _CommentStart(_pos, end);
+		for (size_t p = _pos; p < comment;) {
+			const void* colon = std::memchr(_text.data() + p, ':', comment - p);
+			if (!colon) {
+				break;
+			}
+			const size_t at = static_cast<size_t>(static_cast<const char*>(colon) - _text.data());
+			if (at + 1 >= end || is_blank(_text[at + 1]) || is_break(_text[at + 1])) {
+				return at;
+			}
+			p = at + 1;
+		}
+		return std::string_view::npos;
+	}
+
+	bool _BlockNode(int parent);
+	bool _BlockMapping(int column);
+	bool _BlockSequence(int column);
+	bool _Value(int parent, bool sequence_at_parent);
+	bool _InlineNode(int parent, bool collections, bool force_string);
+	bool _PlainScalar(int parent, bool force_string);
+	bool _BlockScalar(int parent);
+	bool _Quoted(std::string& out);
+	bool _Escape(std::string& out);
+	bool _Properties(std::string& anchor, bool& force_string);
+	bool _Alias();
+	bool _FlowNode();
+	void _FlowSpace();
+	std::string_view _FlowPlain();
+	void _Scalar(std::string_view text);
+};
+
+bool YamlParser::Parse() {
+	if (_text.starts_with("\xEF\xBB\xBF")) {
+		_pos = _line_start = 3;
+	}
+	// Directives, then the optional "---" that starts the document. A node may follow the marker on its line.
+	while (_SkipToContent() && !_eof && _Peek() == '%') {
+		if (!_NextLine()) {
+			_eof = true;
+			break;
+		}
+	}
+	if (!_error.empty()) {
+		return false;
+	}
+	bool inline_root = false;
+	if (_eof && _pos < _text.size() && _text.substr(_pos).starts_with("---")) {
+		_eof = false;
+		_pos += 3;
+		_SkipBlanks();
+		inline_root = !_AtLineEnd();
+		if (!inline_root && !_NextContent()) {
+			return false;
+		}
+	}
+
+	_out.BeginRoot();
+	if (inline_root) {
+		std::string anchor;
+		bool force_string = false;
+		if (!_Properties(anchor, force_string) || !_InlineNode(-1, false, force_string)) {
+			return false;
+		}
+	} else if (_eof) {
+		_out.Literal('n');
+	} else if (!_BlockNode(-1)) {
+		return false;
+	}
+	if (!_eof) {
+		return _Fail("unexpected content after the document");
+	}
+	_out.EndRoot();
+	return true;
+}
+
+// A node that starts a line.
+bool YamlParser::_BlockNode(int parent) {
+	if (_IsSequenceEntry()) {
+		return _BlockSequence(_Column());
+	}
+	if (_Peek() == '?' && (is_blank(_Peek(1)) || is_break(_Peek(1)))) {
+		return _Fail("explicit keys are not supported");
+	}
+	if (_KeyEnd() != std::string_view::npos) {
+		return _BlockMapping(_Column());
+	}
+	std::string anchor;
+	bool force_string = false;
+	const size_t begin = _out.size();
+	if (!_Properties(anchor, force_string) || !_InlineNode(parent, false, force_string)) {
+		return false;
+	}
+	if (!anchor.empty()) {
+		_anchors[anchor] = {begin, _out.size()};
+	}
+	return true;
+}
+
+bool YamlParser::_BlockMapping(int column) {
+	if (++_depth > kMaxDepth) {
+		return _Fail("nesting too deep");
+	}
+	const size_t open = _out.Open();
+	size_t count = 0;
+	for (;;) {
+		const size_t colon = _KeyEnd();
+		if (colon == std::string_view::npos) {
+			return _Fail(_IsSequenceEntry() ? "sequence entry where a mapping key was expected" : "expected a mapping key");
+		}
+		if (_Peek() == '"' || _Peek() == '\'') {
+			std::string key;
+			if (!_Quoted(key)) {
+				return false;
+			}
+			_out.String(key);
+		} else {
+			auto key = _text.substr(_pos, colon - _pos);
+			while (!key.empty() && is_blank(key.back())) {
+				key.remove_suffix(1);
+			}
+			_out.String(key);
+		}
+		_pos = colon + 1;
+		if (!_Value(column, true)) {
+			return false;
+		}
+		++count;
+		if (_eof || _Column() < column) {
+			break;
+		}
+		if (_Column() > column) {
+			return _Fail("bad indentation of a mapping entry");
+		}
+	}
+	_out.Close(open, '{', count);
+	--_depth;
+	return true;
+}
+
+bool YamlParser::_BlockSequence(int column) {
+	if (++_depth > kMaxDepth) {
+		return _Fail("nesting too deep");
+	}
+	const size_t open = _out.Open();
+	size_t count = 0;
+	do {
+		++_pos; // The '-'.
+		if (!_Value(column, false)) {
+			return false;
+		}
+		++count;
+		if (_eof || _Column() < column) {
+			break;
+		}
+		if (_Column() > column) {
+			return _Fail("bad indentation of a sequence entry");
+		}
+	} while (_IsSequenceEntry());
+	_out.Close(open, '[', count);
+	--_depth;
+	return true;
+}
+
+// The value after "key:" or "-", on the same line or on the lines that follow, which must be indented further than
+// parent. A sequence may also sit at the same indentation as the key that holds it.
+bool YamlParser::_Value(int parent, bool sequence_at_parent) {
+	_SkipBlanks();
+	std::string anchor;
+	bool force_string = false;
+	if (!_Properties(anchor, force_string)) {
+		return false;
+	}
+	const size_t begin = _out.size();
+	if (_AtLineEnd()) {
+		if (!_NextContent()) {
+			return false;
+		}
+		if (!_eof && (_Column() > parent || (sequence_at_parent && _Column() == parent && _IsSequenceEntry()))) {
+			if (!_BlockNode(parent)) {
+				return false;
+			}
+		} else {
+			_out.Literal('n');
+		}
+	} else if (!_InlineNode(parent, !sequence_at_parent, force_string)) {
+		return false;
+	}
+	if (!anchor.empty()) {
+		_anchors[anchor] = {begin, _out.size()};
+	}
+	return true;
+}
+
+// A node that starts mid-line. Only a sequence entry ("- a: b", "- - c") may open a block collection there.
+bool YamlParser::_InlineNode(int parent, bool collections, bool force_string) {
+	if (collections) {
+		if (_IsSequenceEntry()) {
+			return _BlockSequence(_Column());
+		}
+		if (_KeyEnd() != std::string_view::npos) {
+			return _BlockMapping(_Column());
+		}
+	}
+	switch (_Peek()) {
+	case '|':
+	case '>':
+		return _BlockScalar(parent);
+	case '[':
+	case '{':
+		return _FlowNode() && _NextContent();
+	case '*':
+		return _Alias() && _NextContent();
+	case '"':
+	case '\'': {
+		std::string value;
+		if (!_Quoted(value)) {
+			return false;
+		}
+		_out.String(value);
+		return _NextContent();
+	}
+	default:
+		return _PlainScalar(parent, force_string);
+	}
+}
+
+// A plain scalar, continued by following lines indented further than parent. Line breaks fold into spaces,
+// empty lines into newlines.
+bool YamlParser::_PlainScalar(int parent, bool force_string) {
+	size_t end = _LineEnd(_pos);
+	end = _CommentStart(_pos, end);
+	auto first = _text.substr(_pos, end - _pos);
+	while (!first.empty() && (is_blank(first.back()) || is_break(first.back()))) {
+		first.remove_suffix(1);
+	}
+	_pos += first.size();
+	if (end < _LineEnd(_pos)) {
+		// A comment ends the scalar.
+		_Scalar(first);
+		return _NextContent();
+	}
+
+	std::string folded;
+	size_t breaks = 0;
+	for (;;) {
+		const auto saved = _Save();
+		if (!_NextLine()) {
+			_Restore(saved);
+			break;
+		}
+		_SkipBlanks();
+		if (_pos < _text.size() && is_break(_text[_pos])) {
+			++breaks;
+			continue;
+		}
+		const bool marker = _Column() == 0 && (_text.substr(_pos).starts_with("---") || _text.substr(_pos).starts_with("..."));
+		if (_pos >= _text.size() || _Column() <= parent || _Peek() == '#' || marker) {
+			_Restore(saved);
+			break;
+		}
+		if (_KeyEnd() != std::string_view::npos) {
+			return _Fail("bad indentation of a mapping entry");
+		}
+		if (folded.empty()) {
+			folded = first;
+		}
+		if (breaks == 0) {
+			folded += ' ';
+		} else {
+			folded.append(breaks, '\n');
+		}
+		breaks = 0;
+		const size_t line_end = _LineEnd(_pos);
+		const size_t comment = _CommentStart(_pos, line_end);
+		auto text = _text.substr(_pos, comment - _pos);
+		while (!text.empty() && (is_blank(text.back()) || is_break(text.back()))) {
+			text.remove_suffix(1);
+		}
+		folded += text;
+		_pos += text.size();
+		if (comment != line_end) {
+			break;
+		}
+	}
+	if (folded.empty()) {
+		if (force_string) {
+			_out.String(first);
+		} else {
+			_Scalar(first);
+		}
+	} else {
+		_out.String(folded);
+	}
+	return _NextContent();
+}
+
+// Resolves a plain scalar through the core schema.
+void YamlParser::_Scalar(std::string_view text) {
+	if (text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL") {
+		_out.Literal('n');
+		return;
+	}
+	if (text == "true" || text == "True" || text == "TRUE") {
+		_out.Literal('t');
+		return;
+	}
+	if (text == "false" || text == "False" || text == "FALSE") {
+		_out.Literal('f');
+		return;
+	}
+	const char c = text[0];
+	if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.') {
+		_out.String(text);
+		return;
+	}
+	auto digits = text.substr(c == '+' ? 1 : 0);
+	int base = 10;
+	if (digits.starts_with("0x") || digits.starts_with("0o")) {
+		base = digits[1] == 'x' ? 16 : 8;
+		digits.remove_prefix(2);
+	}
+	const char* last = digits.data() + digits.size();
+	int64_t i = 0;
+	if (auto [ptr, ec] = std::from_chars(digits.data(), last, i, base); ec == std::errc() && ptr == last && !digits.empty()) {
+		_out.Int64(i);
+		return;
+	}
+	uint64_t u = 0;
+	if (auto [ptr, ec] = std::from_chars(digits.data(), last, u, base); ec == std::errc() && ptr == last && !digits.empty()) {
+		_out.Uint64(u);
+		return;
+	}
+	double d = 0;
+	if (base == 10 && is_core_float(text)) {
+		if (std::from_chars(digits.data(), last, d).ec == std::errc::result_out_of_range) {
+			// Out of range, from_chars leaves d alone; strtod rounds to infinity or to zero.
+			d = std::strtod(std::string(digits).c_str(), nullptr);
+		}
+		_out.Double(d);
+		return;
+	}
+	const auto special = text.substr(c == '-' || c == '+' ? 1 : 0);
+	if (special == ".inf" || special == ".Inf" || special == ".INF") {
+		_out.Double(c == '-' ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity());
+	} else if (text == ".nan" || text == ".NaN" || text == ".NAN") {
+		_out.Double(std::numeric_limits<double>::quiet_NaN());
+	} else {
+		_out.String(text);
+	}
+}
+
+// "|" or ">", optional indentation and chomping indicators, then the lines indented further than parent.
+bool YamlParser::_BlockScalar(int parent) {
+	const bool literal = _Peek() == '|';
+	++_pos;
+	int chomp = 0; // -1 strips the final line break, 0 keeps one, 1 keeps all trailing ones.
+	int indent = 0;
+	for (int i = 0; i < 2; ++i) {
+		const char c = _Peek();
+		if (c == '-' || c == '+') {
+			chomp = c == '-' ? -1 : 1;
+			++_pos;
+		} else if (c >= '1' && c <= '9') {
+			indent = std::max(parent, 0) + (c - '0');
+			++_pos;
+		}
+	}
+	_SkipBlanks();
+	if (!_AtLineEnd()) {
+		return _Fail("unexpected text after a block scalar indicator");
+	}
+
+	std::string value;
+	size_t breaks = 0;
+	bool first = true, more_indented = false, last_break = false;
+	bool ended = true;
+	while (_NextLine()) {
+		size_t spaces = 0;
+		while (_pos + spaces < _text.size() && _text[_pos + spaces] == ' ') {
+			++spaces;
+		}
+		const size_t end = _LineEnd(_pos);
+		const size_t content_end = end > _pos && _text[end - 1] == '\r' ? end - 1 : end;
+		if (_pos + spaces >= content_end && (indent == 0 || spaces <= static_cast<size_t>(indent))) {
+			++breaks;
+			continue;
+		}
+		if (indent == 0) {
+			if (static_cast<int>(spaces) <= parent) {
+				ended = false;
+				break;
+			}
+			indent = static_cast<int>(spaces);
+		}
+		if (spaces < static_cast<size_t>(indent)) {
+			ended = false;
+			break;
+		}
+		const auto text = _text.substr(_pos + indent, content_end - _pos - indent);
+		const bool more = !literal && !text.empty() && is_blank(text[0]);
+		if (first) {
+			value.append(breaks, '\n');
+		} else if (literal || more || more_indented) {
+			value.append(breaks + 1, '\n');
+		} else if (breaks == 0) {
+			value += ' ';
+		} else {
+			value.append(breaks, '\n');
+		}
+		value += text;
+		last_break = end < _text.size();
+		first = false;
+		more_indented = more;
+		breaks = 0;
+	}
+	// The final line break is only there if the text did not end on the last line.
+	if (chomp == 1) {
+		value.append(first || !last_break ? breaks : breaks + 1, '\n');
+	} else if (chomp == 0 && last_break) {
+		value += '\n';
+	}
+	_out.String(value);
+
+	// The line that ended the scalar is the next content, unless the text ended.
+	if (ended) {
+		_eof = true;
+		return true;
+	}
+	return _SkipToContent();
+}
+
+bool YamlParser::_Quoted(std::string& out) {
+	const char quote = _text[_pos++];
+	while (_pos < _text.size()) {
+		const char c = _text[_pos];
+		if (c == quote) {
+			if (quote == '\'' && _Peek(1) == '\'') {
+				out += '\'';
+				_pos += 2;
+				continue;
+			}
+			++_pos;
+			return true;
+		}
+		if (c == '\\' && quote == '"') {
+			if (!_Escape(out)) {
+				return false;
+			}
+			continue;
+		}
+		if (is_break(c)) {
+			// A line break folds into a space, or into one newline per empty line that follows it.
+			while (!out.empty() && is_blank(out.back())) {
+				out.pop_back();
+			}
+			size_t breaks = 0;
+			while (_NextLine()) {
+				_SkipBlanks();
+				if (_pos >= _text.size() || !is_break(_text[_pos])) {
+					break;
+				}
+				++breaks;
+			}
+			if (breaks == 0) {
+				out += ' ';
+			} else {
+				out.append(breaks, '\n');
+			}
+			continue;
+		}
+		out += c;
+		++_pos;
+	}
+	return _Fail("unterminated quoted scalar");
+}
+
+bool YamlParser::_Escape(std::string& out) {
+	++_pos; // The backslash.
+	const char c = _Peek();
+	++_pos;
+	const auto hex = [&](int digits) {
+		uint32_t cp = 0;
+		if (_pos + digits > _text.size() || std::from_chars(_text.data() + _pos, _text.data() + _pos + digits, cp, 16).ptr != _text.data() + _pos + digits) {
+			return UINT32_MAX;
+		}
+		_pos += digits;
+		return cp;
+	};
+	uint32_t cp = 0;
+	switch (c) {
+	case '0': out += '\0'; return true;
+	case 'a': out += '\a'; return true;
+	case 'b': out += '\b'; return true;
+	case 't':
+	case '\t': out += '\t'; return true;
+	case 'n': out += '\n'; return true;
+	case 'v': out += '\v'; return true;
+	case 'f': out += '\f'; return true;
+	case 'r': out += '\r'; return true;
+	case 'e': out += '\x1B'; return true;
+	case ' ': out += ' '; return true;
+	case '"': out += '"'; return true;
+	case '/': out += '/'; return true;
+	case '\\': out += '\\'; return true;
+	case 'N': append_utf8(out, 0x85); return true;
+	case '_': append_utf8(out, 0xA0); return true;
+	case 'L': append_utf8(out, 0x2028); return true;
+	case 'P': append_utf8(out, 0x2029); return true;
+	case 'x': cp = hex(2); break;
+	case 'u':
+		cp = hex(4);
+		// A UTF-16 surrogate pair, as JSON writes characters outside the BMP.
+		if (cp >= 0xD800 && cp < 0xDC00 && _Peek() == '\\' && _Peek(1) == 'u') {
+			_pos += 2;
+			const uint32_t low = hex(4);
+			cp = low >= 0xDC00 && low < 0xE000 ? 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00) : UINT32_MAX;
+		}
+		break;
+	case 'U': cp = hex(8); break;
+	case '\r':
+	case '\n':
+		// An escaped line break joins the lines without a space.
+		--_pos;
+		_NextLine();
+		_SkipBlanks();
+		return true;
+	default:
+		return _Fail("invalid escape sequence");
+	}
+	if (cp > 0x10FFFF) {
+		return _Fail("invalid escape sequence");
+	}
+	append_utf8(out, cp);
+	return true;
+}
+
+// Anchors ("&name") and tags ("!tag"). !!str makes a plain scalar a string; other tags are ignored.
+bool YamlParser::_Properties(std::string& anchor, bool& force_string) {
+	while (_Peek() == '&' || _Peek() == '!') {
+		const char c = _Peek();
+		const size_t start = ++_pos;
+		while (_pos < _text.size() && !is_blank(_text[_pos]) && !is_break(_text[_pos]) && !is_flow_indicator(_text[_pos])) {
+			++_pos;
+		}
+		const auto name = _text.substr(start, _pos - start);
+		if (c == '&') {
+			if (name.empty()) {
+				return _Fail("empty anchor name");
+			}
+			anchor = name;
+		} else if (name == "!str") {
+			force_string = true;
+		}
+		_SkipBlanks();
+	}
+	return true;
+}
+
+bool YamlParser::_Alias() {
+	const size_t start = ++_pos;
+	while (_pos < _text.size() && !is_blank(_text[_pos]) && !is_break(_text[_pos]) && !is_flow_indicator(_text[_pos])) {
+		++_pos;
+	}
+	const auto it = _anchors.find(std::string(_text.substr(start, _pos - start)));
+	if (it == _anchors.end()) {
+		return _Fail("unknown alias");
+	}
+	_out.Copy(it->second.first, it->second.second);
+	return true;
+}
+
+// Blanks, line breaks and comments between the tokens of a flow collection.
+void YamlParser::_FlowSpace() {
+	while (_pos < _text.size()) {
+		const char c = _text[_pos];
+		if (is_blank(c) || c == '\r') {
+			++_pos;
+		} else if (c == '\n') {
+			_NextLine();
+		} else if (c == '#') {
+			_pos = _LineEnd(_pos);
+		} else {
+			break;
+		}
+	}
+}
+
+// A plain scalar inside a flow collection: ends at a flow indicator, at ':' before a blank or one, or at a comment.
+// Following lines continue it, folded as in _PlainScalar; the folded text is kept in _folded.
+std::string_view YamlParser::_FlowPlain() {
+	const auto at_end = [this](size_t start) {
+		const char c = _Peek();
+		return c == '\0' || is_flow_indicator(c) || is_break(c)
+			|| (c == ':' && (_pos + 1 >= _text.size() || is_blank(_Peek(1)) || is_break(_Peek(1)) || is_flow_indicator(_Peek(1))))
+			|| (c == '#' && _pos > start && is_blank(_text[_pos - 1]));
+	};
+	const auto line = [&] {
+		const size_t start = _pos;
+		while (!at_end(start)) {
+			++_pos;
+		}
+		auto text = _text.substr(start, _pos - start);
+		while (!text.empty() && is_blank(text.back())) {
+			text.remove_suffix(1);
+		}
+		return text;
+	};
+	const auto first = line();
+	bool folded = false;
+	while (is_break(_Peek())) {
+		const auto saved = _Save();
+		size_t breaks = 0;
+		while (_pos < _text.size() && (is_blank(_text[_pos]) || is_break(_text[_pos]))) {
+			if (_text[_pos] == '\n') {
+				++breaks;
+				_NextLine();
+			} else {
+				++_pos;
+			}
+		}
+		// A line that starts with a comment or an indicator is not a continuation.
+		if (_Peek() == '#' || at_end(_pos)) {
+			_Restore(saved);
+			break;
+		}
+		if (!folded) {
+			_folded = first;
+			folded = true;
+		}
+		if (breaks <= 1) {
+			_folded += ' ';
+		} else {
+			_folded.append(breaks - 1, '\n');
+		}
+		_folded += line();
+	}
+	return folded ? std::string_view(_folded) : first;
+}
+
+bool YamlParser::_FlowNode() {
+	std::string anchor;
+	bool force_string = false;
+	if (!_Properties(anchor, force_string)) {
+		return false;
+	}
+	const size_t begin = _out.size();
+	const char c = _Peek();
+	if (c == '[' || c == '{') {
+		if (++_depth > kMaxDepth) {
+			return _Fail("nesting too deep");
+		}
+		const char close = c == '[' ? ']' : '}';
+		const size_t open = _out.Open();
+		size_t count = 0;
+		++_pos;
+		for (;;) {
+			_FlowSpace();
+			if (_Peek() == close) {
+				++_pos;
+				break;
+			}
+			const bool explicit_key = _Peek() == '?' && (is_blank(_Peek(1)) || is_break(_Peek(1)));
+			if (explicit_key && c == '[') {
+				return _Fail("explicit keys are not supported");
+			}
+			if (c == '{') {
+				// Keys are always strings. A key without a value, as in {a, b}, maps to null. "? " may mark one.
+				if (explicit_key) {
+					++_pos;
+					_FlowSpace();
+				}
+				if (_Peek() == '"' || _Peek() == '\'') {
+					std::string key;
+					if (!_Quoted(key)) {
+						return false;
+					}
+					_out.String(key);
+				} else {
+					_out.String(_FlowPlain());
+				}
+				_FlowSpace();
+				if (_Peek() == ':') {
+					++_pos;
+					_FlowSpace();
+				}
+				if (_Peek() == ',' || _Peek() == '}') {
+					_out.Literal('n');
+				} else if (!_FlowNode()) {
+					return false;
+				}
+			} else if (!_FlowNode()) {
+				return false;
+			}
+			++count;
+			_FlowSpace();
+			if (_Peek() == ',') {
+				++_pos;
+			} else if (_Peek() == close) {
+				++_pos;
+				break;
+			} else {
+				return _Fail(c == '[' ? "expected ',' or ']'" : "expected ',' or '}'");
+			}
+		}
+		_out.Close(open, c, count);
+		--_depth;
+	} else if (c == '"' || c == '\'') {
+		std::string value;
+		if (!_Quoted(value)) {
+			return false;
+		}
+		_out.String(value);
+	} else if (c == '*') {
+		if (!_Alias()) {
+			return false;
+		}
+	} else if (c == '\0' || is_flow_indicator(c)) {
+		return _Fail("expected a value");
+	} else if (force_string) {
+		_out.String(_FlowPlain());
+	} else {
+		_Scalar(_FlowPlain());
+	}
+	if (!anchor.empty()) {
+		_anchors[anchor] = {begin, _out.size()};
+	}
+	return true;
+}
+
+} // namespace
+
+bool ParseYaml(std::string_view yaml, simdjson::dom::document& doc, std::string* error) {
+	TapeWriter tape;
+	YamlParser parser(yaml, tape);
+	if (!parser.Parse()) {
+		if (error) {
+			*error = parser.Error();
+		}
+		return false;
+	}
+	if (!tape.Finish(doc)) {
+		if (error) {
+			*error = "out of memory";
+		}
+		return false;
+	}
+	return true;
+}
+
+} // namespace openapi